@@ -0,0 +1,221 @@
+#include "batchprocessor.h"
+#include "schema.h"
+#include "element.h"
+#include "conductor.h"
+#include "conductorbundle.h"
+
+/**
+	Thread de traitement : il traite les fichiers de sa file, puis ceux qu'il
+	parvient a voler aux autres threads, toujours dans le meme Schema.
+*/
+class BatchProcessor::Worker : public QThread {
+	public:
+	Worker(BatchProcessor *p, int n) : processeur(p), numero(n) {
+		// QGraphicsScene s'enregistre aupres de la QApplication a sa creation :
+		// le schema est donc cree dans le thread principal, puis confie au worker
+		schema = new Schema();
+		schema -> setItemIndexMethod(QGraphicsScene::NoIndex);
+		schema -> moveToThread(this);
+	}
+	~Worker() {
+		delete schema;
+	}
+	protected:
+	void run() {
+		int index;
+		while (processeur -> prochainFichier(numero, &index)) {
+			processeur -> resultats[index] = processeur -> traiter(index, numero, *schema);
+		}
+		schema -> reset();
+	}
+	private:
+	BatchProcessor *processeur;
+	int numero;
+	Schema *schema;
+};
+
+/**
+	Constructeur
+	@param op Operation a appliquer a chaque fichier
+	@param f Format de sortie de l'export : png, svg ou pdf (ignore pour les autres operations)
+*/
+BatchProcessor::BatchProcessor(Operation op, const QString &f) : operation(op), nb_threads(0) {
+	format = operation == Conversion ? QString("qet") : f;
+}
+
+/**
+	Definit ou ecrire les fichiers produits. Le chemin d'un fichier relativement
+	au dossier source est conserve sous le dossier de sortie.
+	@param source Dossier a partir duquel les fichiers ont ete collectes
+	@param sortie Dossier de sortie ; s'il est vide, chaque fichier est ecrit a cote de son schema
+*/
+void BatchProcessor::setOutput(const QString &source, const QString &sortie) {
+	dossier_source = source;
+	dossier_sortie = sortie;
+}
+
+/**
+	@return Le nombre de threads utilises : celui demande, ou a defaut le nombre de coeurs
+*/
+int BatchProcessor::jobs() const {
+	return(nb_threads > 0 ? nb_threads : qMax(1, QThread::idealThreadCount()));
+}
+
+/**
+	Traite une liste de fichiers
+	@param liste Les schemas a traiter
+	@return Les resultats, dans l'ordre de la liste
+*/
+QVector<BatchProcessor::Resultat> BatchProcessor::run(const QStringList &liste) {
+	fichiers = liste;
+	resultats = QVector<Resultat>(fichiers.size());
+	int n = qMax(1, qMin(jobs(), fichiers.size()));
+	
+	// repartition initiale par blocs contigus ; les ecarts de duree entre
+	// fichiers sont ensuite absorbes par le vol de travail
+	files.clear();
+	for (int i = 0 ; i < n ; ++ i) files << new FileFichiers();
+	for (int i = 0 ; i < fichiers.size() ; ++ i) files[qint64(i) * n / fichiers.size()] -> indices << i;
+	
+	QList<Worker *> workers;
+	for (int i = 0 ; i < n ; ++ i) workers << new Worker(this, i);
+	foreach(Worker *w, workers) w -> start();
+	foreach(Worker *w, workers) w -> wait();
+	qDeleteAll(workers);
+	qDeleteAll(files);
+	files.clear();
+	return(resultats);
+}
+
+/**
+	Fournit le prochain fichier a traiter par un thread : la tete de sa propre
+	file, ou a defaut la queue de la file d'un autre thread.
+	@param thread Numero du thread demandeur
+	@param index Recoit l'index du fichier a traiter
+	@return false s'il ne reste plus aucun fichier a traiter
+*/
+bool BatchProcessor::prochainFichier(int thread, int *index) {
+	int n = files.size();
+	for (int i = 0 ; i < n ; ++ i) {
+		FileFichiers *f = files.at((thread + i) % n);
+		QMutexLocker verrou(&(f -> verrou));
+		if (f -> indices.isEmpty()) continue;
+		*index = i ? f -> indices.takeLast() : f -> indices.takeFirst();
+		return(true);
+	}
+	return(false);
+}
+
+/**
+	Traite un fichier. Toute erreur, y compris une exception, est consignee
+	dans le resultat sans interrompre le lot.
+	@param index Index du fichier dans la liste
+	@param thread Numero du thread
+	@param schema Schema du thread, vide a l'issue du traitement precedent
+	@return Le resultat du traitement
+*/
+BatchProcessor::Resultat BatchProcessor::traiter(int index, int thread, Schema &schema) {
+	Resultat r;
+	r.fichier = fichiers.at(index);
+	r.reussi  = false;
+	r.thread  = thread;
+	QElapsedTimer chrono;
+	chrono.start();
+	try {
+		schema.reset();
+		QFile file(r.fichier);
+		QDomDocument document;
+		if (!file.open(QIODevice::ReadOnly)) {
+			r.message = "fichier illisible";
+		} else if (!document.setContent(&file)) {
+			r.message = "document XML invalide";
+		} else if (!schema.fromXml(document)) {
+			r.message = "chargement du schema impossible";
+		} else if (operation == Validation) {
+			// chaque element et chaque conducteur decrit doit avoir ete charge
+			int nb_elements = 0, nb_conducteurs = 0;
+			QDomElement racine = document.documentElement();
+			for (QDomElement e = racine.firstChildElement("elements") ; !e.isNull() ; e = e.nextSiblingElement("elements")) {
+				nb_elements += e.elementsByTagName("element").size();
+			}
+			for (QDomElement c = racine.firstChildElement("conducteurs") ; !c.isNull() ; c = c.nextSiblingElement("conducteurs")) {
+				nb_conducteurs += c.elementsByTagName("conductor").size();
+			}
+			int elements_charges = 0, conducteurs_charges = 0;
+			foreach(QGraphicsItem *qgi, schema.items()) {
+				if (qgi -> type() == Element::Type) ++ elements_charges;
+				else if (qgi -> type() == Conductor::Type) ++ conducteurs_charges;
+				else if (qgi -> type() == ConductorBundle::Type) conducteurs_charges += qgraphicsitem_cast<ConductorBundle *>(qgi) -> size();
+			}
+			if (elements_charges != nb_elements) {
+				r.message = QString("%1 element(s) charge(s) sur %2").arg(elements_charges).arg(nb_elements);
+			} else if (conducteurs_charges != nb_conducteurs) {
+				r.message = QString("%1 conducteur(s) charge(s) sur %2").arg(conducteurs_charges).arg(nb_conducteurs);
+			} else r.reussi = true;
+		} else {
+			QString sortie = cheminSortie(r.fichier);
+			QDir().mkpath(QFileInfo(sortie).absolutePath());
+			if (schema.exportTo(sortie, format)) r.reussi = true;
+			else r.message = "ecriture de " + sortie + " impossible";
+		}
+	} catch (const std::exception &e) {
+		r.message = QString("exception : %1").arg(e.what());
+	} catch (...) {
+		r.message = "exception inconnue";
+	}
+	r.duree_ms = chrono.elapsed();
+	return(r);
+}
+
+/**
+	@param entree Chemin d'un schema
+	@return Le chemin du fichier a produire pour ce schema
+*/
+QString BatchProcessor::cheminSortie(const QString &entree) const {
+	QFileInfo info(entree);
+	QString nom = info.completeBaseName() + "." + format;
+	if (dossier_sortie.isEmpty()) return(info.absoluteDir().filePath(nom));
+	QString relatif = dossier_source.isEmpty() ? QString() : QDir(dossier_source).relativeFilePath(info.absolutePath());
+	if (relatif == "." || relatif.startsWith("..")) relatif = QString();
+	return(QDir(QDir(dossier_sortie).filePath(relatif)).filePath(nom));
+}
+
+/**
+	@param dossier Racine de l'arborescence a parcourir
+	@return Les schemas *.qet de l'arborescence, tries par chemin
+*/
+QStringList BatchProcessor::collectFiles(const QString &dossier) {
+	QStringList liste;
+	QDirIterator it(dossier, QStringList() << "*.qet", QDir::Files, QDirIterator::Subdirectories | QDirIterator::FollowSymlinks);
+	while (it.hasNext()) liste << it.next();
+	liste.sort();
+	return(liste);
+}
+
+/**
+	Ecrit le rapport d'un lot : un resume, puis une ligne par fichier au format CSV
+	@param nom_fichier Chemin du rapport
+	@param resultats Resultats du lot
+	@param duree_ms Duree totale du lot en millisecondes
+	@return true si l'ecriture a reussi, false sinon
+*/
+bool BatchProcessor::writeReport(const QString &nom_fichier, const QVector<Resultat> &resultats, qint64 duree_ms) {
+	QFile file(nom_fichier);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return(false);
+	int nb_echecs = 0, nb_threads = 0;
+	foreach(const Resultat &r, resultats) {
+		if (!r.reussi) ++ nb_echecs;
+		nb_threads = qMax(nb_threads, r.thread + 1);
+	}
+	QTextStream out(&file);
+	out.setCodec("UTF-8");
+	out << "# fichiers : " << resultats.size() << ", echecs : " << nb_echecs;
+	out << ", duree : " << QString::number(duree_ms / 1000.0, 'f', 3) << " s, threads : " << nb_threads << "\n";
+	out << "fichier;statut;duree_ms;thread;message\n";
+	foreach(const Resultat &r, resultats) {
+		out << r.fichier << ";" << (r.reussi ? "ok" : "echec") << ";" << r.duree_ms << ";";
+		out << r.thread << ";" << QString(r.message).replace(';', ',') << "\n";
+	}
+	file.close();
+	return(true);
+}
@@ -0,0 +1,53 @@
+#ifndef BATCHPROCESSOR_H
+	#define BATCHPROCESSOR_H
+	#include <QtCore>
+	class Schema;
+	/**
+		Traitement par lots de schemas *.qet : validation, export (png, svg, pdf)
+		ou conversion (qet). Les fichiers sont repartis entre plusieurs threads ;
+		chaque thread possede sa propre file de fichiers et son propre Schema, et
+		vient piocher dans les files des autres threads lorsque la sienne est
+		vide. Les definitions d'elements sont lues dans le cache partage
+		d'ElementDefinition.
+		L'echec d'un fichier n'interrompt jamais le traitement des autres.
+	*/
+	class BatchProcessor {
+		public:
+		enum Operation { Validation, Export, Conversion };
+		/// resultat du traitement d'un fichier
+		struct Resultat {
+			QString fichier;
+			bool reussi;
+			QString message;
+			qint64 duree_ms;
+			int thread;
+		};
+
+		BatchProcessor(Operation, const QString & = QString());
+		void setOutput(const QString &, const QString &);
+		void setJobs(int n) { nb_threads = n; }
+		int jobs() const;
+		QVector<Resultat> run(const QStringList &);
+		static QStringList collectFiles(const QString &);
+		static bool writeReport(const QString &, const QVector<Resultat> &, qint64);
+
+		private:
+		class Worker;
+		/// file de fichiers d'un thread : il prend en tete, les autres volent en queue
+		struct FileFichiers {
+			QMutex verrou;
+			QList<int> indices;
+		};
+		Operation operation;
+		QString format;
+		QString dossier_source;
+		QString dossier_sortie;
+		int nb_threads;
+		QStringList fichiers;
+		QVector<FileFichiers *> files;
+		QVector<Resultat> resultats;
+		bool prochainFichier(int, int *);
+		Resultat traiter(int, int, Schema &);
+		QString cheminSortie(const QString &) const;
+	};
+#endif
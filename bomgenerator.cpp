@@ -0,0 +1,148 @@
+#include "bomgenerator.h"
+#include "schema.h"
+#include "elementdefinition.h"
+
+/**
+	Ajoute a la nomenclature les elements d'un schema ouvert
+	@param schema Le schema
+	@param folio Nom du folio, repris dans la nomenclature
+*/
+void BomGenerator::addSchema(const Schema *schema, const QString &folio) {
+	QHash<QString, int> comptes = schema -> elementTypeCounts();
+	for (QHash<QString, int>::const_iterator it = comptes.constBegin() ; it != comptes.constEnd() ; ++ it) {
+		ajoute(it.key(), it.value(), folio);
+	}
+}
+
+/**
+	Ajoute a la nomenclature les elements d'un fichier *.qet. Le fichier est lu
+	en flux : seuls les attributs "type" des elements sont releves.
+	@param nom_fichier Chemin du schema
+	@return true si le fichier a pu etre lu, false sinon
+*/
+bool BomGenerator::addFile(const QString &nom_fichier) {
+	QFile fichier(nom_fichier);
+	if (!fichier.open(QIODevice::ReadOnly)) return(false);
+	QString folio = QFileInfo(nom_fichier).completeBaseName();
+	QHash<QString, int> comptes;
+	QXmlStreamReader lecteur(&fichier);
+	int profondeur = 0;
+	bool dans_elements = false;
+	while (!lecteur.atEnd()) {
+		QXmlStreamReader::TokenType jeton = lecteur.readNext();
+		if (jeton == QXmlStreamReader::StartElement) {
+			++ profondeur;
+			// schema > elements > element
+			if (profondeur == 2) dans_elements = (lecteur.name() == "elements");
+			else if (profondeur == 3 && dans_elements && lecteur.name() == "element") {
+				++ comptes[lecteur.attributes().value("type").toString()];
+			}
+		} else if (jeton == QXmlStreamReader::EndElement) {
+			-- profondeur;
+		}
+	}
+	if (lecteur.hasError()) return(false);
+	for (QHash<QString, int>::const_iterator it = comptes.constBegin() ; it != comptes.constEnd() ; ++ it) {
+		ajoute(it.key(), it.value(), folio);
+	}
+	return(true);
+}
+
+/**
+	@return Le nombre total d'elements de la nomenclature
+*/
+int BomGenerator::elementCount() const {
+	int total = 0;
+	foreach(const Ligne &l, lignes) total += l.quantite;
+	return(total);
+}
+
+/**
+	@param nom Nom d'un format : "csv" ou "html", sans tenir compte de la casse
+	@param format Recoit le format correspondant
+	@return true si le nom designe un format connu
+*/
+bool BomGenerator::formatFromName(const QString &nom, Format *format) {
+	QString n = nom.toLower();
+	if (n == "csv") *format = Csv;
+	else if (n == "html" || n == "htm") *format = Html;
+	else return(false);
+	return(true);
+}
+
+/**
+	Ecrit la nomenclature dans un fichier
+	@param nom_fichier Chemin du fichier a ecrire
+	@param format Format de la nomenclature
+	@return true si l'ecriture a reussi, false sinon
+*/
+bool BomGenerator::write(const QString &nom_fichier, Format format) const {
+	QFile fichier(nom_fichier);
+	if (!fichier.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) return(false);
+	return(write(&fichier, format));
+}
+
+/**
+	Ecrit la nomenclature, triee par type, sur un peripherique deja ouvert
+	@param sortie Peripherique sur lequel ecrire
+	@param format Format de la nomenclature
+	@return true si l'ecriture a reussi, false sinon
+*/
+bool BomGenerator::write(QIODevice *sortie, Format format) const {
+	// la table ne compte qu'une ligne par type : la trier est negligeable
+	QMap<QString, int> ordre;
+	for (int i = 0 ; i < lignes.size() ; ++ i) ordre.insert(lignes.at(i).type, i);
+	
+	QTextStream flux(sortie);
+	flux.setCodec("UTF-8");
+	if (format == Csv) {
+		flux << "type;nom;quantite;folios" << endl;
+	} else {
+		flux << "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><title>Nomenclature</title></head><body>\n";
+		flux << "<table border=\"1\">\n<tr><th>Type</th><th>Nom</th><th>Quantit&eacute;</th><th>Folios</th></tr>\n";
+	}
+	foreach(int i, ordre) {
+		const Ligne &l = lignes.at(i);
+		if (format == Csv) {
+			flux << l.type << ";" << l.nom << ";" << l.quantite << ";" << l.folios.join(",") << "\n";
+		} else {
+			flux << "<tr><td>" << l.type.toHtmlEscaped() << "</td><td>" << l.nom.toHtmlEscaped() << "</td><td>";
+			flux << l.quantite << "</td><td>" << l.folios.join(", ").toHtmlEscaped() << "</td></tr>\n";
+		}
+		if (flux.status() != QTextStream::Ok) return(false);
+	}
+	if (format == Html) flux << "</table>\n</body></html>" << endl;
+	flux.flush();
+	return(flux.status() == QTextStream::Ok);
+}
+
+/**
+	Ajoute des elements d'un meme type a la nomenclature
+	@param type Type des elements (nom du fichier de definition)
+	@param quantite Nombre d'elements
+	@param folio Folio ou ils apparaissent
+*/
+void BomGenerator::ajoute(const QString &type, int quantite, const QString &folio) {
+	if (quantite <= 0) return;
+	QHash<QString, int>::const_iterator it = index_types.constFind(type);
+	if (it == index_types.constEnd()) {
+		Ligne l;
+		l.type = type;
+		l.nom = nomType(type);
+		l.quantite = 0;
+		it = index_types.insert(type, lignes.size());
+		lignes << l;
+	}
+	Ligne &l = lignes[it.value()];
+	l.quantite += quantite;
+	if (!l.folios.contains(folio)) l.folios << folio;
+}
+
+/**
+	@param type Type d'element, tel qu'enregistre dans les fichiers *.qet
+	@return Le nom de l'element, lu dans sa definition, ou le type a defaut
+*/
+QString BomGenerator::nomType(const QString &type) {
+	const ElementDefinition *definition = ElementDefinition::get("elements/" + type);
+	return(definition -> nom().isEmpty() ? type : definition -> nom());
+}
@@ -0,0 +1,38 @@
+#ifndef BOMGENERATOR_H
+	#define BOMGENERATOR_H
+	#include <QtCore>
+	class Schema;
+	/**
+		Nomenclature (bill of materials) : les elements poses sont regroupes par
+		type, avec leur nom, leur quantite et les folios ou ils apparaissent.
+		Les quantites sont lues dans la table des types tenue a jour par chaque
+		Schema, ou directement dans les fichiers *.qet, en un seul passage et
+		sans instancier les elements. La nomenclature est ecrite ligne par ligne,
+		en CSV ou en HTML.
+	*/
+	class BomGenerator {
+		public:
+		enum Format { Csv, Html };
+		void addSchema(const Schema *, const QString &);
+		bool addFile(const QString &);
+		int lineCount() const { return(lignes.size()); }
+		int elementCount() const;
+		bool write(QIODevice *, Format) const;
+		bool write(const QString &, Format) const;
+		static bool formatFromName(const QString &, Format *);
+
+		private:
+		/// ligne de la nomenclature : un type d'element
+		struct Ligne {
+			QString type;
+			QString nom;
+			int quantite;
+			QStringList folios;
+		};
+		QVector<Ligne> lignes;
+		/// position de chaque type dans la liste des lignes
+		QHash<QString, int> index_types;
+		void ajoute(const QString &, int, const QString &);
+		static QString nomType(const QString &);
+	};
+#endif
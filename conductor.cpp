@@ -1,7 +1,17 @@
+#include <algorithm>
 #include <QtDebug>
 #include "conductor.h"
 #include "element.h"
+#include "schema.h"
+#include "conductorrouter.h"
+#include "paintstats.h"
 #include "debug.h"
+
+/// radius of the arc drawn where a conductor jumps over another one
+#define RAYON_SAUT 3.0
+/// margin around the segments of a conductor for hit tests ; it covers the jumps
+#define MARGE_SELECTION 3.0
+
 /**
 Builder
 @param p1 First Terminal to which the driver is linked
@@ -20,32 +30,58 @@ Conductor::Conductor(Terminal *p1, Terminal* p2, Element *parent, QGraphicsScene
 	// in case of failure of the addition (driver already existing in particular)
 	if (!ajout_p1 || !ajout_p2) return;
 	destroyed = false;
+	dirty = false;
  // the driver is represented by a thin line
 	QPen t;
 	t.setWidthF(1.0);
 	setPen(t);
+	// ajout du conducteur a la scene
+	if (scene) scene -> addItem(this);
+	if (Schema *s = qobject_cast<Schema *>(scene)) s -> conductorAdded(this);
 	// calcul du rendu du conducteur
 	calculateConductor();
 }
 
 /**
-	Updates the graphical representation of the driver.
+	Updates the graphical representation of the driver. The path itself is
+	recomputed later, see markDirty().
 	@param rect Rectangle to update
 */
 void Conductor::update(const QRectF &rect = QRectF()) {
-	calculateConductor();
+	markDirty();
 	QGraphicsPathItem::update(rect);
 }
 
 /**
-	Destroyer of the Conductor. Before being destroyed, the conductor unhooks from the terminals
-	to which it is linked.
+	Updates the graphical representation of the driver. The path itself is
+	recomputed later, see markDirty().
 */
 void Conductor::update(qreal x, qreal y, qreal width, qreal height) {
-	calculateConductor();
+	markDirty();
 	QGraphicsPathItem::update(x, y, width, height);
 }
 
+/**
+	Signals that a terminal of the conductor has moved. On a Schema, the path is
+	recomputed once, during the next recompute pass of the Schema, however many
+	times the conductor was marked in between ; elsewhere it is recomputed at once.
+*/
+void Conductor::markDirty() {
+	if (Schema *s = qobject_cast<Schema *>(scene())) {
+		dirty = true;
+		s -> markConductorDirty(this);
+	} else calculateConductor();
+}
+
+/**
+	Recomputes the path of the conductor if it was marked dirty
+*/
+void Conductor::recalculate() {
+	if (!dirty) return;
+	dirty = false;
+	calculateConductor();
+}
+
  /**
  Destroyer of the Conductor. Before being destroyed, the conductor unhooks from the terminals
  to which it is linked.
@@ -55,66 +91,206 @@ void Conductor::update(qreal x, qreal y, qreal width, qreal height) {
 }*/
 
 /**
-Updates the QPainterPath constituting the conductor to obtain
-a conductor only consists of straight lines connecting the two terminals.
+Updates the QPainterPath constituting the conductor. On a Schema with automatic
+routing, the path avoids the elements of the schema ; otherwise, or when the
+router gives up, one of the fixed L / Z shapes is used.
 */
 void Conductor::calculateConductor() {
-	QPainterPath t;
 	trace_msg("");
 	QPointF p1 = terminal1 -> amarrageConducteur();
 	QPointF p2 = terminal2 -> amarrageConducteur();
+	Terminal::Orientation o1 = terminal1 -> orientation();
+	Terminal::Orientation o2 = terminal2 -> orientation();
+	Schema *s = qobject_cast<Schema *>(scene());
 	
-	QPointF depart, arrivee;
-	Terminal::Orientation ori_depart, ori_arrivee;
-	// distingue le depart de l'arrivee : le trajet se fait toujours de gauche a droite
-	if (p1.x() <= p2.x()) {
-		depart      = mapFromScene(p1);
-		arrivee     = mapFromScene(p2);
-		ori_depart  = terminal1 -> orientation();
-		ori_arrivee = terminal2 -> orientation();
-	} else {
-		depart      = mapFromScene(p2);
-		arrivee     = mapFromScene(p1);
-		ori_depart  = terminal2 -> orientation();
-		ori_arrivee = terminal1 -> orientation();
+	// both terminals moved by the same offset (group move) : the previous path
+	// is only translated, provided it does not run into an element
+	if (!trajet.isEmpty() && o1 == cle_o1 && o2 == cle_o2 && p2 - p1 == cle_decalage && p1 != cle_origine) {
+		QPointF delta = p1 - cle_origine;
+		if (!s || !s -> autoRouting() || s -> pathIsClear(trajet.translated(delta), this)) {
+			PAINTSTATS_COUNT(translations);
+			translatePath(delta);
+			return;
+		}
 	}
 	
-	// debut du trajet
-	t.moveTo(depart);
-	if (depart.y() < arrivee.y()) {
- // downward path
-		if ((ori_depart == Terminal::Nord && (ori_arrivee == Terminal::Sud || ori_arrivee == Terminal::Ouest)) || (ori_depart == Terminal::Est && ori_arrivee == Terminal::Ouest)) {
- // case   3  
-			qreal ligne_inter_x = (depart.x() + arrivee.x()) / 2.0;
-			t.lineTo(ligne_inter_x, depart.y());
-			t.lineTo(ligne_inter_x, arrivee.y());
-		} else if ((ori_depart == Terminal::Sud && (ori_arrivee == Terminal::Nord || ori_arrivee == Terminal::Est)) || (ori_depart == Terminal::Ouest && ori_arrivee == Terminal::Est)) {
- // case   4  
-			qreal ligne_inter_y = (depart.y() + arrivee.y()) / 2.0;
-			t.lineTo(depart.x(), ligne_inter_y);
-			t.lineTo(arrivee.x(), ligne_inter_y);
-		} else if ((ori_depart == Terminal::Nord || ori_depart == Terminal::Est) && (ori_arrivee == Terminal::Nord || ori_arrivee == Terminal::Est)) {
-			t.lineTo(arrivee.x(), depart.y()); // cas  2 
-		} else t.lineTo(depart.x(), arrivee.y()); // cas  1 
-	} else {
- // upward journey
-		if ((ori_depart == Terminal::Ouest && (ori_arrivee == Terminal::Est || ori_arrivee == Terminal::Sud)) || (ori_depart == Terminal::Nord && ori_arrivee == Terminal::Sud)) {
- // case   3  
-			qreal ligne_inter_y = (depart.y() + arrivee.y()) / 2.0;
-			t.lineTo(depart.x(), ligne_inter_y);
-			t.lineTo(arrivee.x(), ligne_inter_y);
-		} else if ((ori_depart == Terminal::Est && (ori_arrivee == Terminal::Ouest || ori_arrivee == Terminal::Nord)) || (ori_depart == Terminal::Sud && ori_arrivee == Terminal::Nord)) {
-			// cas  4 
-			qreal ligne_inter_x = (depart.x() + arrivee.x()) / 2.0;
-			t.lineTo(ligne_inter_x, depart.y());
-			t.lineTo(ligne_inter_x, arrivee.y());
-		} else if ((ori_depart == Terminal::Ouest || ori_depart == Terminal::Nord) && (ori_arrivee == Terminal::Ouest || ori_arrivee == Terminal::Nord)) {
-			t.lineTo(depart.x(), arrivee.y()); // cas  2 
-		} else t.lineTo(arrivee.x(), depart.y()); // cas  1 
+	PAINTSTATS_COUNT(calculs);
+	QPolygonF t;
+	if (s && s -> autoRouting()) t = s -> routeConductor(p1, o1, p2, o2);
+	if (t.isEmpty()) t = ConductorRouter::fixedShape(p1, o1, p2, o2);
+	setPolyline(t);
+}
+
+/**
+	Replaces the path of the conductor by a path computed elsewhere, for
+	instance by Schema::rerouteAll(). The conductor is no longer dirty.
+	@param t Vertices of the new path, in scene coordinates
+*/
+void Conductor::setPolyline(const QPolygonF &t) {
+	dirty = false;
+	trajet = t;
+	cle_origine  = terminal1 -> amarrageConducteur();
+	cle_decalage = terminal2 -> amarrageConducteur() - cle_origine;
+	cle_o1 = terminal1 -> orientation();
+	cle_o2 = terminal2 -> orientation();
+	buildPath();
+	if (Schema *s = qobject_cast<Schema *>(scene())) s -> conductorGeometryChanged(this);
+}
+
+/**
+	Sets the points where the conductor jumps over other conductors. These
+	points are computed by the Schema, see CrossingFinder ; they must lie on
+	horizontal segments of the path.
+	@param points Jump points, in scene coordinates
+*/
+void Conductor::setJumps(const QList<QPointF> &points) {
+	if (points == sauts) return;
+	sauts = points;
+	buildPath();
+}
+
+/**
+	Builds the QPainterPath of the conductor from its vertices, with a small
+	arc at each jump point. A jump too close to a corner or to a previous jump
+	is not drawn.
+*/
+void Conductor::buildPath() {
+	QPainterPath chemin;
+	if (trajet.isEmpty()) {
+		setPath(chemin);
+		return;
+	}
+	chemin.moveTo(trajet.first());
+	for (int i = 1 ; i < trajet.size() ; ++ i) {
+		QPointF a = trajet.at(i - 1), b = trajet.at(i);
+		if (!sauts.isEmpty() && a.y() == b.y() && a.x() != b.x()) {
+			qreal sens = b.x() > a.x() ? 1.0 : -1.0;
+			QList<qreal> abscisses;
+			foreach(QPointF p, sauts) {
+				if (p.y() == a.y() && sens * (p.x() - a.x()) >= RAYON_SAUT && sens * (b.x() - p.x()) >= RAYON_SAUT) abscisses << sens * p.x();
+			}
+			std::sort(abscisses.begin(), abscisses.end());
+			qreal dernier = sens * a.x();
+			foreach(qreal x, abscisses) {
+				if (x - RAYON_SAUT < dernier) continue;
+				chemin.lineTo(sens * (x - RAYON_SAUT), a.y());
+				QRectF cercle(sens * x - RAYON_SAUT, a.y() - RAYON_SAUT, 2 * RAYON_SAUT, 2 * RAYON_SAUT);
+				chemin.arcTo(cercle, sens > 0 ? 180.0 : 0.0, sens > 0 ? -180.0 : 180.0);
+				dernier = x + RAYON_SAUT;
+			}
+		}
+		chemin.lineTo(b);
+	}
+	setPath(mapFromScene(chemin));
+	updateShape();
+}
+
+/**
+	Recomputes the cached hit-test rectangles and bounding rectangle of the
+	conductor ; must be called each time the path changes.
+*/
+void Conductor::updateShape() {
+	zones.clear();
+	forme = QPainterPath();
+	// overlapping rectangles must not cancel each other out
+	forme.setFillRule(Qt::WindingFill);
+	for (int i = 1 ; i < trajet.size() ; ++ i) {
+		QRectF zone = QRectF(mapFromScene(trajet.at(i - 1)), mapFromScene(trajet.at(i))).normalized();
+		zone.adjust(-MARGE_SELECTION, -MARGE_SELECTION, MARGE_SELECTION, MARGE_SELECTION);
+		zones << zone;
+		forme.addRect(zone);
+	}
+	qreal demi_trait = pen().widthF() / 2.0;
+	rect_englobant = path().controlPointRect().adjusted(-demi_trait, -demi_trait, demi_trait, demi_trait);
+	rect_englobant |= forme.controlPointRect();
+}
+
+/**
+	@return The bounding rectangle of the conductor, computed when the path changed
+*/
+QRectF Conductor::boundingRect() const {
+	return(rect_englobant);
+}
+
+/**
+	@return The shape of the conductor : one rectangle per segment, instead of
+	the stroke of the path computed on each call by QGraphicsPathItem
+*/
+QPainterPath Conductor::shape() const {
+	return(forme);
+}
+
+/**
+	@param p A point, in item coordinates
+	@return true if the point lies near one of the segments of the conductor
+*/
+bool Conductor::contains(const QPointF &p) const {
+	if (!rect_englobant.contains(p)) return(false);
+	foreach(const QRectF &zone, zones) if (zone.contains(p)) return(true);
+	return(false);
+}
+
+/**
+	Collision test used by the scene, notably for rubber-band selection. A
+	rectangular area, the common case, is tested directly against the segment
+	rectangles ; other areas use the cached shape.
+	@param p An area, in item coordinates
+	@param mode Selection mode
+	@return true if the conductor collides with the area, according to the mode
+*/
+bool Conductor::collidesWithPath(const QPainterPath &p, Qt::ItemSelectionMode mode) const {
+	QRectF r;
+	if ((mode == Qt::IntersectsItemShape || mode == Qt::ContainsItemShape) && estRectangle(p, r)) {
+		if (mode == Qt::ContainsItemShape) {
+			foreach(const QRectF &zone, zones) if (!r.contains(zone)) return(false);
+			return(!zones.isEmpty());
+		}
+		if (!r.intersects(rect_englobant)) return(false);
+		foreach(const QRectF &zone, zones) if (r.intersects(zone)) return(true);
+		return(false);
+	}
+	return(QGraphicsPathItem::collidesWithPath(p, mode));
+}
+
+/**
+	@param p A path
+	@param r Receives the rectangle described by the path, if any
+	@return true if the path is a closed axis-aligned rectangle, as produced
+	by the rubber band of an unrotated view
+*/
+bool Conductor::estRectangle(const QPainterPath &p, QRectF &r) {
+	if (p.elementCount() != 5 || !p.elementAt(0).isMoveTo()) return(false);
+	for (int i = 1 ; i < 5 ; ++ i) {
+		QPainterPath::Element a = p.elementAt(i - 1), b = p.elementAt(i);
+		if (!b.isLineTo() || (a.x != b.x && a.y != b.y)) return(false);
+	}
+	if (p.elementAt(0).x != p.elementAt(4).x || p.elementAt(0).y != p.elementAt(4).y) return(false);
+	r = p.controlPointRect();
+	return(true);
+}
+
+/**
+	Translates the path of the conductor without recomputing it
+	@param delta Offset of both terminals since the path was computed
+*/
+void Conductor::translatePath(const QPointF &delta) {
+	trajet.translate(delta);
+	for (int i = 0 ; i < sauts.size() ; ++ i) sauts[i] += delta;
+	cle_origine += delta;
+	setPath(path().translated(delta));
+	updateShape();
+	if (Schema *s = qobject_cast<Schema *>(scene())) s -> conductorGeometryChanged(this);
+}
+
+/**
+	@param r A rectangle, in scene coordinates
+	@return true if one of the segments of the conductor touches the rectangle
+*/
+bool Conductor::traverse(const QRectF &r) const {
+	for (int i = 1 ; i < trajet.size() ; ++ i) {
+		if (SpatialIndex<Conductor *>::chevauche(QRectF(trajet.at(i - 1), trajet.at(i)).normalized(), r)) return(true);
 	}
- // end of trip
-	t.lineTo(arrivee);
-	setPath(t);
+	return(false);
 }
 
 /**
@@ -126,6 +302,7 @@ Draw the driver without antialiasing.
 */
 void Conductor::paint(QPainter *qp, const QStyleOptionGraphicsItem *qsogi, QWidget *qw) {
 	trace_msg("");
+	PAINTSTATS_COUNT(conductors);
 	qp -> save();
 	qp -> setRenderHint(QPainter::Antialiasing,          false);
 	qp -> setRenderHint(QPainter::TextAntialiasing,      false);
@@ -171,6 +348,7 @@ void Conductor::destroy() {
 	destroyed = true;
 	terminal1 -> removeConducteur(this);
 	terminal2 -> removeConducteur(this);
+	if (Schema *s = qobject_cast<Schema *>(scene())) s -> conductorRemoved(this);
 }
 
 /**
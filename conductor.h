@@ -17,16 +17,53 @@
 		bool isDestroyed() const { return(destroyed); }
 		void update(const QRectF & rect);
 		void update(qreal x, qreal y, qreal width, qreal height);
+		void markDirty();
+		void recalculate();
+		bool isDirty() const { return(dirty); }
+		/// Vertices of the path of the conductor, in scene coordinates
+		QPolygonF polyline() const { return(trajet); }
+		void setPolyline(const QPolygonF &);
+		void setJumps(const QList<QPointF> &);
+		bool traverse(const QRectF &) const;
 		void paint(QPainter *, const QStyleOptionGraphicsItem *, QWidget *);
+		QRectF boundingRect() const;
+		QPainterPath shape() const;
+		bool contains(const QPointF &) const;
+		bool collidesWithPath(const QPainterPath &, Qt::ItemSelectionMode = Qt::IntersectsItemShape) const;
 		static bool valideXml(QDomElement &);
 		
 		/// First terminal to which the wire is attached
 		Terminal *terminal1;
 		/// Second terminal to which the wire is attached
 		Terminal *terminal2;
+		/// GroupMove translates the paths of the conductors it moves
+		friend class GroupMove;
 		private:
 		/// booleen indicating if the thread is still valid
 		bool destroyed;
+		/// booleen indicating if the path must be recomputed
+		bool dirty;
+		/// vertices of the path, in scene coordinates
+		QPolygonF trajet;
+		/// position of the first terminal when the path was computed
+		QPointF cle_origine;
+		/// relative position of the second terminal when the path was computed
+		QPointF cle_decalage;
+		/// orientations of the terminals when the path was computed
+		Terminal::Orientation cle_o1;
+		Terminal::Orientation cle_o2;
+		/// points where the path jumps over another conductor, in scene coordinates
+		QList<QPointF> sauts;
+		/// rectangles around the segments of the path, in item coordinates, used for hit tests
+		QVector<QRectF> zones;
+		/// union of the rectangles above, returned by shape()
+		QPainterPath forme;
+		/// bounding rectangle, recomputed only when the path changes
+		QRectF rect_englobant;
+		void translatePath(const QPointF &);
+		void buildPath();
+		void updateShape();
+		static bool estRectangle(const QPainterPath &, QRectF &);
 		
 		void calculateConductor();
 		bool surLeMemeAxe(Terminal::Orientation, Terminal::Orientation);
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include "conductorbundle.h"
+#include "conductorrouter.h"
+#include "schema.h"
+#include "paintstats.h"
+
+/// ecart entre deux liaisons voisines d'un faisceau
+#define ECART_FAISCEAU 4.0
+
+/**
+	Constructeur. Les deux listes doivent avoir la meme taille ; une borne ne
+	peut appartenir qu'a un seul faisceau.
+	@param b1 Bornes de depart des liaisons
+	@param b2 Bornes d'arrivee des liaisons, dans le meme ordre
+	@param scene QGraphicsScene a laquelle le faisceau appartient
+*/
+ConductorBundle::ConductorBundle(const QList<Terminal *> &b1, const QList<Terminal *> &b2, QGraphicsScene *scene) :
+	QGraphicsPathItem(),
+	bornes1(b1),
+	bornes2(b2),
+	destroyed(false),
+	dirty(false)
+{
+	Q_ASSERT_X(b1.size() == b2.size() && !b1.isEmpty(), "ConductorBundle", "Both groups of terminals should have the same, non-zero size");
+	foreach(Terminal *t, bornes1) t -> setBundle(this);
+	foreach(Terminal *t, bornes2) t -> setBundle(this);
+	QPen t;
+	t.setWidthF(1.0);
+	setPen(t);
+	if (scene) scene -> addItem(this);
+	if (Schema *s = qobject_cast<Schema *>(scene)) s -> bundleAdded(this);
+	calculateBundle();
+}
+
+/**
+	Prepare la destruction du faisceau : il se detache de toutes ses bornes
+*/
+void ConductorBundle::destroy() {
+	destroyed = true;
+	foreach(Terminal *t, bornes1) t -> setBundle(0);
+	foreach(Terminal *t, bornes2) t -> setBundle(0);
+	if (Schema *s = qobject_cast<Schema *>(scene())) s -> bundleRemoved(this);
+}
+
+/**
+	Signale qu'une borne du faisceau a bouge ; comme pour les conducteurs, le
+	recalcul est differe a la prochaine passe du Schema.
+*/
+void ConductorBundle::markDirty() {
+	if (Schema *s = qobject_cast<Schema *>(scene())) {
+		dirty = true;
+		s -> markBundleDirty(this);
+	} else calculateBundle();
+}
+
+/**
+	Recalcule le faisceau s'il a ete marque
+*/
+void ConductorBundle::recalculate() {
+	if (!dirty) return;
+	dirty = false;
+	calculateBundle();
+}
+
+/**
+	Route le tronc entre les centres des deux groupes de bornes, puis construit
+	un unique QPainterPath contenant toutes les liaisons.
+*/
+void ConductorBundle::calculateBundle() {
+	PAINTSTATS_COUNT(calculs);
+	int n = size();
+	QPointF c1, c2;
+	for (int i = 0 ; i < n ; ++ i) {
+		c1 += bornes1.at(i) -> amarrageConducteur();
+		c2 += bornes2.at(i) -> amarrageConducteur();
+	}
+	c1 /= n;
+	c2 /= n;
+	Terminal::Orientation o1 = bornes1.first() -> orientation();
+	Terminal::Orientation o2 = bornes2.first() -> orientation();
+	
+	Schema *s = qobject_cast<Schema *>(scene());
+	QPolygonF t;
+	if (s && s -> autoRouting()) t = s -> routeConductor(c1, o1, c2, o2);
+	if (t.isEmpty()) t = ConductorRouter::fixedShape(c1, o1, c2, o2);
+	// les formes fixes vont toujours de gauche a droite : le tronc doit partir du premier groupe
+	if (t.first() != c1) std::reverse(t.begin(), t.end());
+	tronc = t;
+	
+	// les voies sont attribuees dans l'ordre des bornes de depart le long du
+	// premier segment, afin que les raccordements ne se croisent pas
+	QPointF n0 = tronc.size() > 1 ? normale(tronc.at(0), tronc.at(1)) : QPointF();
+	QList<QPair<qreal, int> > rangs;
+	for (int i = 0 ; i < n ; ++ i) {
+		QPointF d = bornes1.at(i) -> amarrageConducteur() - c1;
+		rangs << qMakePair(d.x() * n0.x() + d.y() * n0.y(), i);
+	}
+	std::sort(rangs.begin(), rangs.end());
+	
+	QPainterPath chemin;
+	for (int rang = 0 ; rang < n ; ++ rang) {
+		int i = rangs.at(rang).second;
+		QPolygonF voie = decale(tronc, (rang - (n - 1) / 2.0) * ECART_FAISCEAU);
+		QPointF a1 = bornes1.at(i) -> amarrageConducteur();
+		QPointF a2 = bornes2.at(i) -> amarrageConducteur();
+		chemin.moveTo(a1);
+		// raccordement orthogonal de la borne a sa voie
+		bool v1 = (o1 == Terminal::Nord || o1 == Terminal::Sud);
+		chemin.lineTo(v1 ? QPointF(a1.x(), voie.first().y()) : QPointF(voie.first().x(), a1.y()));
+		foreach(QPointF p, voie) chemin.lineTo(p);
+		bool v2 = (o2 == Terminal::Nord || o2 == Terminal::Sud);
+		chemin.lineTo(v2 ? QPointF(a2.x(), voie.last().y()) : QPointF(voie.last().x(), a2.y()));
+		chemin.lineTo(a2);
+	}
+	setPath(mapFromScene(chemin));
+}
+
+/**
+	@param a Debut d'un segment horizontal ou vertical
+	@param b Fin du segment
+	@return La normale unitaire du segment (nulle si le segment est vide)
+*/
+QPointF ConductorBundle::normale(const QPointF &a, const QPointF &b) {
+	QPointF d = b - a;
+	qreal l = qAbs(d.x()) + qAbs(d.y());
+	if (l == 0.0) return(QPointF());
+	return(QPointF(-d.y() / l, d.x() / l));
+}
+
+/**
+	Decale une ligne brisee orthogonale
+	@param t Sommets de la ligne
+	@param ecart Decalage, du cote de la normale de chaque segment
+	@return La ligne decalee
+*/
+QPolygonF ConductorBundle::decale(const QPolygonF &t, qreal ecart) {
+	QPolygonF resultat;
+	for (int k = 0 ; k < t.size() ; ++ k) {
+		QPointF n_avant = k > 0 ? normale(t.at(k - 1), t.at(k)) : QPointF();
+		QPointF n_apres = k < t.size() - 1 ? normale(t.at(k), t.at(k + 1)) : QPointF();
+		QPointF n;
+		if (n_avant.isNull()) n = n_apres;
+		else if (n_apres.isNull() || n_apres == n_avant) n = n_avant;
+		else n = n_avant + n_apres; // coin : intersection des deux segments decales
+		resultat << t.at(k) + ecart * n;
+	}
+	return(resultat);
+}
+
+/**
+	Dessine le faisceau sans antialiasing
+	@param qp Le QPainter a utiliser
+	@param qsogi Les options de style
+	@param qw Le QWidget sur lequel on dessine
+*/
+void ConductorBundle::paint(QPainter *qp, const QStyleOptionGraphicsItem *qsogi, QWidget *qw) {
+	PAINTSTATS_COUNT(conductors);
+	qp -> save();
+	qp -> setRenderHint(QPainter::Antialiasing,          false);
+	qp -> setRenderHint(QPainter::TextAntialiasing,      false);
+	qp -> setRenderHint(QPainter::SmoothPixmapTransform, false);
+	QGraphicsPathItem::paint(qp, qsogi, qw);
+	qp -> restore();
+}
@@ -0,0 +1,41 @@
+#ifndef CONDUCTORBUNDLE_H
+	#define CONDUCTORBUNDLE_H
+	#include <QtGui>
+	#include "terminal.h"
+	/**
+		Faisceau de conducteurs : N liaisons paralleles entre deux groupes
+		ordonnes de bornes (typiquement deux borniers), representees par un seul
+		item. Un tronc unique est route entre les deux groupes ; chaque liaison
+		suit ce tronc avec un decalage qui lui est propre, puis rejoint ses bornes.
+		A l'enregistrement, le faisceau est ecrit sous forme de conducteurs
+		individuels portant le meme attribut "bundle".
+	*/
+	class ConductorBundle : public QGraphicsPathItem {
+		public:
+		enum { Type = UserType + 1003 };
+		virtual int type() const { return Type; }
+		ConductorBundle(const QList<Terminal *> &, const QList<Terminal *> &, QGraphicsScene * = 0);
+		
+		int size() const { return(bornes1.size()); }
+		const QList<Terminal *> &terminals1() const { return(bornes1); }
+		const QList<Terminal *> &terminals2() const { return(bornes2); }
+		QPolygonF trunk() const { return(tronc); }
+		void destroy();
+		bool isDestroyed() const { return(destroyed); }
+		void markDirty();
+		void recalculate();
+		void paint(QPainter *, const QStyleOptionGraphicsItem *, QWidget *);
+		
+		private:
+		/// bornes de depart et d'arrivee ; la liaison i relie bornes1[i] a bornes2[i]
+		QList<Terminal *> bornes1;
+		QList<Terminal *> bornes2;
+		/// trajet commun aux liaisons, en coordonnees de la scene
+		QPolygonF tronc;
+		bool destroyed;
+		bool dirty;
+		void calculateBundle();
+		static QPolygonF decale(const QPolygonF &, qreal);
+		static QPointF normale(const QPointF &, const QPointF &);
+	};
+#endif
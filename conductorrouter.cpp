@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <limits>
+#include <queue>
+#include "conductorrouter.h"
+#include "schema.h"
+
+/// nombre maximal par defaut d'etats developpes lors d'une recherche de trajet
+#define BUDGET_ROUTAGE 20000
+/// nombre de cases de grille ajoutees autour des deux bornes pour la recherche
+#define MARGE_ROUTAGE 10
+/// distance minimale entre un conducteur et le contour d'un element
+#define ECART_OBSTACLE 2.0
+
+namespace {
+	/// directions de deplacement sur la grille
+	enum Direction { Droite, Gauche, Bas, Haut };
+	const int dx[4] = { 1, -1, 0,  0 };
+	const int dy[4] = { 0,  0, 1, -1 };
+
+	/// etat ouvert de l'A* : cout estime total et identifiant (noeud * 4 + direction)
+	struct Ouvert {
+		qreal f;
+		int etat;
+		bool operator<(const Ouvert &o) const { return(f > o.f); }
+	};
+
+	/**
+		@param o Orientation d'une borne
+		@return La direction dans laquelle un conducteur quitte la borne
+	*/
+	int sortie(Terminal::Orientation o) {
+		switch(o) {
+			case Terminal::Nord  : return(Haut);
+			case Terminal::Est   : return(Droite);
+			case Terminal::Ouest : return(Gauche);
+			case Terminal::Sud   :
+			default              : return(Bas);
+		}
+	}
+	
+	/**
+		Lot de conducteurs consecutifs route par un thread de routeAll()
+	*/
+	class LotRoutage : public QRunnable {
+		public:
+		LotRoutage(const ConductorRouter &r, const QVector<ConductorRouter::Requete> &q, QPolygonF *t, int d, int f, bool e) :
+			routeur(r), requetes(q), trajets(t), debut(d), fin(f), evitement(e) {}
+		void run() {
+			for (int i = debut ; i < fin ; ++ i) {
+				const ConductorRouter::Requete &q = requetes.at(i);
+				QPolygonF t;
+				if (evitement) t = routeur.route(q.p1, q.o1, q.p2, q.o2);
+				if (t.isEmpty()) t = ConductorRouter::fixedShape(q.p1, q.o1, q.p2, q.o2);
+				trajets[i] = t;
+			}
+		}
+		private:
+		const ConductorRouter &routeur;
+		const QVector<ConductorRouter::Requete> &requetes;
+		QPolygonF *trajets;
+		int debut;
+		int fin;
+		bool evitement;
+	};
+}
+
+/**
+	Constructeur
+	@param index Index spatial des elements du schema, qui servent d'obstacles
+*/
+ConductorRouter::ConductorRouter(const SpatialIndex<Element *> &index) :
+	obstacles(index),
+	budget_etats(BUDGET_ROUTAGE),
+	penalite_coude(2.0 * GRILLE_X)
+{
+}
+
+/**
+	Liste les coordonnees de la grille de recherche sur un axe : les multiples
+	du pas compris dans l'intervalle, plus les coordonnees des deux bornes, qui
+	ne sont pas forcement sur la grille.
+	@param min Debut de l'intervalle
+	@param max Fin de l'intervalle
+	@param pas Pas de la grille
+	@param a Coordonnee de la premiere borne
+	@param b Coordonnee de la seconde borne
+	@return Les coordonnees triees, sans doublon
+*/
+QVector<qreal> ConductorRouter::coordonnees(qreal min, qreal max, qreal pas, qreal a, qreal b) {
+	QVector<qreal> c;
+	for (qreal v = qFloor(min / pas) * pas ; v <= max ; v += pas) c << v;
+	c << a << b;
+	std::sort(c.begin(), c.end());
+	QVector<qreal> resultat;
+	foreach(qreal v, c) if (resultat.isEmpty() || v - resultat.last() > 0.01) resultat << v;
+	return(resultat);
+}
+
+/**
+	Cherche un trajet orthogonal entre deux bornes
+	@param depart Point d'amarrage de la premiere borne, en coordonnees de la scene
+	@param ori_depart Orientation de la premiere borne
+	@param arrivee Point d'amarrage de la seconde borne, en coordonnees de la scene
+	@param ori_arrivee Orientation de la seconde borne
+	@return Les sommets du trajet, ou un trajet vide si la recherche a echoue
+*/
+QPolygonF ConductorRouter::route(const QPointF &depart, Terminal::Orientation ori_depart, const QPointF &arrivee, Terminal::Orientation ori_arrivee) const {
+	// zone de recherche : le rectangle des deux bornes, elargi
+	QRectF zone = QRectF(depart, arrivee).normalized().adjusted(
+		-MARGE_ROUTAGE * GRILLE_X, -MARGE_ROUTAGE * GRILLE_Y,
+		 MARGE_ROUTAGE * GRILLE_X,  MARGE_ROUTAGE * GRILLE_Y
+	);
+	QVector<qreal> xs = coordonnees(zone.left(), zone.right(),  GRILLE_X, depart.x(), arrivee.x());
+	QVector<qreal> ys = coordonnees(zone.top(),  zone.bottom(), GRILLE_Y, depart.y(), arrivee.y());
+	int nx = xs.size(), ny = ys.size();
+	int i_depart  = std::lower_bound(xs.begin(), xs.end(), depart.x()  - 0.01) - xs.begin();
+	int j_depart  = std::lower_bound(ys.begin(), ys.end(), depart.y()  - 0.01) - ys.begin();
+	int i_arrivee = std::lower_bound(xs.begin(), xs.end(), arrivee.x() - 0.01) - xs.begin();
+	int j_arrivee = std::lower_bound(ys.begin(), ys.end(), arrivee.y() - 0.01) - ys.begin();
+	if (i_depart == i_arrivee && j_depart == j_arrivee) return(QPolygonF());
+	
+	// noeuds bloques par les elements presents dans la zone
+	QVector<bool> bloque(nx * ny, false);
+	foreach(Element *e, obstacles.query(zone)) {
+		QRectF r = obstacles.rect(e).adjusted(-ECART_OBSTACLE, -ECART_OBSTACLE, ECART_OBSTACLE, ECART_OBSTACLE);
+		int i1 = std::lower_bound(xs.begin(), xs.end(), r.left())  - xs.begin();
+		int i2 = std::upper_bound(xs.begin(), xs.end(), r.right()) - xs.begin();
+		int j1 = std::lower_bound(ys.begin(), ys.end(), r.top())   - ys.begin();
+		int j2 = std::upper_bound(ys.begin(), ys.end(), r.bottom())- ys.begin();
+		for (int i = i1 ; i < i2 ; ++ i) {
+			for (int j = j1 ; j < j2 ; ++ j) bloque[i * ny + j] = true;
+		}
+	}
+	bloque[i_depart  * ny + j_depart]  = false;
+	bloque[i_arrivee * ny + j_arrivee] = false;
+	
+	// A* sur les etats (noeud, direction d'arrivee dans le noeud)
+	const qreal infini = std::numeric_limits<qreal>::max();
+	QVector<qreal> cout(nx * ny * 4, infini);
+	QVector<int> precedent(nx * ny * 4, -1);
+	std::priority_queue<Ouvert> ouverts;
+	int entree = sortie(ori_arrivee) ^ 1; // direction dans laquelle on entre dans la borne d'arrivee
+	int etat_depart = (i_depart * ny + j_depart) * 4 + sortie(ori_depart);
+	cout[etat_depart] = 0.0;
+	Ouvert o0 = { 0.0, etat_depart };
+	ouverts.push(o0);
+	int etat_final = -1;
+	int nb_iterations = 0;
+	while (!ouverts.empty()) {
+		Ouvert o = ouverts.top();
+		ouverts.pop();
+		if (++ nb_iterations > budget_etats) return(QPolygonF());
+		int noeud = o.etat / 4, dir = o.etat % 4;
+		int i = noeud / ny, j = noeud % ny;
+		if (i == i_arrivee && j == j_arrivee) {
+			etat_final = o.etat;
+			break;
+		}
+		qreal g = cout[o.etat];
+		if (o.f - g > qAbs(xs[i] - arrivee.x()) + qAbs(ys[j] - arrivee.y()) + 0.001) continue; // etat deja traite
+		for (int d = 0 ; d < 4 ; ++ d) {
+			if (d == (dir ^ 1)) continue; // pas de demi-tour
+			int ni = i + dx[d], nj = j + dy[d];
+			if (ni < 0 || nj < 0 || ni >= nx || nj >= ny) continue;
+			int voisin = ni * ny + nj;
+			if (bloque[voisin]) continue;
+			qreal ng = g + qAbs(xs[ni] - xs[i]) + qAbs(ys[nj] - ys[j]);
+			if (d != dir) ng += penalite_coude;
+			if (ni == i_arrivee && nj == j_arrivee && d != entree) ng += penalite_coude;
+			int etat = voisin * 4 + d;
+			if (ng >= cout[etat]) continue;
+			cout[etat] = ng;
+			precedent[etat] = o.etat;
+			Ouvert suivant = { ng + qAbs(xs[ni] - arrivee.x()) + qAbs(ys[nj] - arrivee.y()), etat };
+			ouverts.push(suivant);
+		}
+	}
+	if (etat_final == -1) return(QPolygonF());
+	
+	// reconstitution du trajet : seuls les coudes sont conserves
+	QPolygonF trajet;
+	trajet << arrivee;
+	int dir_courante = etat_final % 4;
+	for (int etat = etat_final ; etat != -1 ; etat = precedent[etat]) {
+		int noeud = etat / 4;
+		if (etat % 4 != dir_courante) {
+			trajet << QPointF(xs[noeud / ny], ys[noeud % ny]);
+			dir_courante = etat % 4;
+		}
+		if (precedent[etat] == -1 && trajet.last() != depart) trajet << depart;
+	}
+	std::reverse(trajet.begin(), trajet.end());
+	return(trajet);
+}
+
+/**
+	Route un ensemble de conducteurs sur plusieurs threads. Seules les
+	requetes et l'index d'obstacles sont lus : l'index doit donc etre une copie
+	qui n'est plus modifiee pendant l'appel, et aucun item n'est manipule.
+	@param requetes Extremites des conducteurs
+	@param evitement false pour n'utiliser que les formes fixes
+	@param nb_threads Nombre de threads, 0 pour un thread par coeur
+	@return Les trajets, dans l'ordre des requetes
+*/
+QVector<QPolygonF> ConductorRouter::routeAll(const QVector<Requete> &requetes, bool evitement, int nb_threads) const {
+	QVector<QPolygonF> trajets(requetes.size());
+	if (requetes.isEmpty()) return(trajets);
+	QThreadPool pool;
+	if (nb_threads > 0) pool.setMaxThreadCount(nb_threads);
+	// des lots assez petits pour equilibrer la charge, assez gros pour amortir leur cout
+	int taille_lot = qMax(64, requetes.size() / (pool.maxThreadCount() * 8) + 1);
+	for (int debut = 0 ; debut < requetes.size() ; debut += taille_lot) {
+		pool.start(new LotRoutage(*this, requetes, trajets.data(), debut, qMin(debut + taille_lot, requetes.size()), evitement));
+	}
+	pool.waitForDone();
+	return(trajets);
+}
+
+/**
+	Trajet d'un conducteur selon les formes fixes en L ou en Z, choisies en
+	fonction de l'orientation des deux bornes, sans tenir compte des obstacles.
+	@param p1 Point d'amarrage de la premiere borne, en coordonnees de la scene
+	@param o1 Orientation de la premiere borne
+	@param p2 Point d'amarrage de la seconde borne, en coordonnees de la scene
+	@param o2 Orientation de la seconde borne
+	@return Les sommets du trajet
+*/
+QPolygonF ConductorRouter::fixedShape(const QPointF &p1, Terminal::Orientation o1, const QPointF &p2, Terminal::Orientation o2) {
+	QPointF depart, arrivee;
+	Terminal::Orientation ori_depart, ori_arrivee;
+	// distingue le depart de l'arrivee : le trajet se fait toujours de gauche a droite
+	if (p1.x() <= p2.x()) {
+		depart      = p1;
+		arrivee     = p2;
+		ori_depart  = o1;
+		ori_arrivee = o2;
+	} else {
+		depart      = p2;
+		arrivee     = p1;
+		ori_depart  = o2;
+		ori_arrivee = o1;
+	}
+	
+	// debut du trajet
+	QPolygonF t;
+	t << depart;
+	if (depart.y() < arrivee.y()) {
+		// trajet descendant
+		if ((ori_depart == Terminal::Nord && (ori_arrivee == Terminal::Sud || ori_arrivee == Terminal::Ouest)) || (ori_depart == Terminal::Est && ori_arrivee == Terminal::Ouest)) {
+			// cas 3
+			qreal ligne_inter_x = (depart.x() + arrivee.x()) / 2.0;
+			t << QPointF(ligne_inter_x, depart.y());
+			t << QPointF(ligne_inter_x, arrivee.y());
+		} else if ((ori_depart == Terminal::Sud && (ori_arrivee == Terminal::Nord || ori_arrivee == Terminal::Est)) || (ori_depart == Terminal::Ouest && ori_arrivee == Terminal::Est)) {
+			// cas 4
+			qreal ligne_inter_y = (depart.y() + arrivee.y()) / 2.0;
+			t << QPointF(depart.x(), ligne_inter_y);
+			t << QPointF(arrivee.x(), ligne_inter_y);
+		} else if ((ori_depart == Terminal::Nord || ori_depart == Terminal::Est) && (ori_arrivee == Terminal::Nord || ori_arrivee == Terminal::Est)) {
+			t << QPointF(arrivee.x(), depart.y()); // cas 2
+		} else t << QPointF(depart.x(), arrivee.y()); // cas 1
+	} else {
+		// trajet montant
+		if ((ori_depart == Terminal::Ouest && (ori_arrivee == Terminal::Est || ori_arrivee == Terminal::Sud)) || (ori_depart == Terminal::Nord && ori_arrivee == Terminal::Sud)) {
+			// cas 3
+			qreal ligne_inter_y = (depart.y() + arrivee.y()) / 2.0;
+			t << QPointF(depart.x(), ligne_inter_y);
+			t << QPointF(arrivee.x(), ligne_inter_y);
+		} else if ((ori_depart == Terminal::Est && (ori_arrivee == Terminal::Ouest || ori_arrivee == Terminal::Nord)) || (ori_depart == Terminal::Sud && ori_arrivee == Terminal::Nord)) {
+			// cas 4
+			qreal ligne_inter_x = (depart.x() + arrivee.x()) / 2.0;
+			t << QPointF(ligne_inter_x, depart.y());
+			t << QPointF(ligne_inter_x, arrivee.y());
+		} else if ((ori_depart == Terminal::Ouest || ori_depart == Terminal::Nord) && (ori_arrivee == Terminal::Ouest || ori_arrivee == Terminal::Nord)) {
+			t << QPointF(depart.x(), arrivee.y()); // cas 2
+		} else t << QPointF(arrivee.x(), depart.y()); // cas 1
+	}
+	// fin du trajet
+	t << arrivee;
+	return(t);
+}
@@ -0,0 +1,41 @@
+#ifndef CONDUCTORROUTER_H
+	#define CONDUCTORROUTER_H
+	#include "terminal.h"
+	#include "spatialindex.h"
+	class Element;
+	/**
+		Routeur orthogonal de conducteurs. Le trajet est cherche par A* sur la
+		grille du schema (GRILLE_X / GRILLE_Y), en contournant les rectangles des
+		elements fournis par un index spatial ; chaque changement de direction est
+		penalise afin de privilegier les trajets a peu de coudes.
+		La recherche est bornee en nombre d'etats developpes, et non en duree :
+		le resultat ne depend ni de la machine ni de sa charge. Au-dela du
+		budget, ou si aucun trajet n'existe, route() retourne un trajet vide et
+		l'appelant se rabat sur les formes fixes de fixedShape().
+	*/
+	class ConductorRouter {
+		public:
+		/// extremites d'un conducteur a router
+		struct Requete {
+			QPointF p1;
+			Terminal::Orientation o1;
+			QPointF p2;
+			Terminal::Orientation o2;
+		};
+		ConductorRouter(const SpatialIndex<Element *> &);
+		void setExpansionBudget(int n) { budget_etats = n; }
+		int expansionBudget() const { return(budget_etats); }
+		void setBendPenalty(qreal p) { penalite_coude = p; }
+		QPolygonF route(const QPointF &, Terminal::Orientation, const QPointF &, Terminal::Orientation) const;
+		QVector<QPolygonF> routeAll(const QVector<Requete> &, bool = true, int = 0) const;
+		static QPolygonF fixedShape(const QPointF &, Terminal::Orientation, const QPointF &, Terminal::Orientation);
+
+		private:
+		const SpatialIndex<Element *> &obstacles;
+		/// nombre maximal d'etats developpes par une recherche
+		int budget_etats;
+		/// cout d'un changement de direction, en unites de longueur
+		qreal penalite_coude;
+		static QVector<qreal> coordonnees(qreal, qreal, qreal, qreal, qreal);
+	};
+#endif
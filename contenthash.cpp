@@ -0,0 +1,172 @@
+#include "contenthash.h"
+#include "element.h"
+#include "terminal.h"
+#include "schema.h"
+
+/**
+	Constructeur : empreinte d'un schema vide
+*/
+ContentHash::ContentHash() : total(0) {
+}
+
+/**
+	Note qu'un element a ete ajoute, deplace ou tourne
+	@param e L'element modifie
+*/
+void ContentHash::elementChanged(Element *e) {
+	elements_a_recalculer.insert(e);
+}
+
+/**
+	Retire un element et ses liaisons de l'empreinte
+	@param e L'element retire du schema
+*/
+void ContentHash::elementRemoved(Element *e) {
+	elements_a_recalculer.remove(e);
+	total -= elements.take(e);
+	foreach(Cle c, liaisons_element.values(e)) oublie(c);
+	liaisons_element.remove(e);
+}
+
+/**
+	Ajoute une liaison entre deux bornes
+	@param a Premiere borne
+	@param b Seconde borne
+	@param faisceau true pour une liaison de faisceau, false pour un conducteur
+*/
+void ContentHash::linkAdded(Terminal *a, Terminal *b, bool faisceau) {
+	Cle c = cle(a, b);
+	QHash<Cle, Liaison>::iterator it = liaisons.find(c);
+	if (it == liaisons.end()) {
+		Liaison l = {
+			qgraphicsitem_cast<Element *>(c.first -> parentItem()), rang(c.first),
+			qgraphicsitem_cast<Element *>(c.second -> parentItem()), rang(c.second),
+			0, 0, 0
+		};
+		if (!l.e1 || !l.e2) return;
+		it = liaisons.insert(c, l);
+		liaisons_element.insert(l.e1, c);
+		if (l.e2 != l.e1) liaisons_element.insert(l.e2, c);
+	}
+	++ (faisceau ? it.value().faisceaux : it.value().conducteurs);
+	liaisons_a_recalculer.insert(c);
+}
+
+/**
+	Retire une liaison entre deux bornes
+	@param a Premiere borne
+	@param b Seconde borne
+	@param faisceau true pour une liaison de faisceau, false pour un conducteur
+*/
+void ContentHash::linkRemoved(Terminal *a, Terminal *b, bool faisceau) {
+	Cle c = cle(a, b);
+	QHash<Cle, Liaison>::iterator it = liaisons.find(c);
+	// la liaison a deja ete oubliee avec l'un de ses elements
+	if (it == liaisons.end()) return;
+	int &nombre = faisceau ? it.value().faisceaux : it.value().conducteurs;
+	if (nombre > 0) -- nombre;
+	if (it.value().conducteurs || it.value().faisceaux) liaisons_a_recalculer.insert(c);
+	else oublie(c);
+}
+
+/**
+	Oublie tous les elements et toutes les liaisons
+*/
+void ContentHash::clear() {
+	total = 0;
+	elements.clear();
+	liaisons.clear();
+	liaisons_element.clear();
+	elements_a_recalculer.clear();
+	liaisons_a_recalculer.clear();
+}
+
+/**
+	@return L'empreinte du schema ; les elements et liaisons modifies depuis
+	le dernier appel sont recalcules
+*/
+quint64 ContentHash::value() {
+	foreach(Element *e, elements_a_recalculer) {
+		QPointF pos = e -> pos();
+		quint64 h = melange(qHash(QFileInfo(e -> typeId()).fileName()));
+		h = melange(h ^ quint32(qRound(pos.x() / GRILLE_X)));
+		h = melange(h ^ quint32(qRound(pos.y() / GRILLE_Y)));
+		h = melange(h ^ quint64(e -> orientation()));
+		total -= elements.value(e);
+		elements.insert(e, h);
+		total += h;
+		foreach(Cle c, liaisons_element.values(e)) liaisons_a_recalculer.insert(c);
+	}
+	elements_a_recalculer.clear();
+	foreach(Cle c, liaisons_a_recalculer) {
+		QHash<Cle, Liaison>::iterator it = liaisons.find(c);
+		if (it == liaisons.end()) continue;
+		total -= it.value().empreinte;
+		it.value().empreinte = empreinte(it.value());
+		total += it.value().empreinte;
+	}
+	liaisons_a_recalculer.clear();
+	return(total);
+}
+
+/**
+	@param l Une liaison
+	@return L'empreinte de la liaison, independante du sens dans lequel elle a
+	ete tracee
+*/
+quint64 ContentHash::empreinte(const Liaison &l) const {
+	quint64 a = melange(elements.value(l.e1) ^ quint32(l.b1));
+	quint64 b = melange(elements.value(l.e2) ^ quint32(l.b2));
+	quint64 h = melange(qMin(a, b) ^ melange(qMax(a, b)));
+	return(quint64(l.conducteurs) * h + quint64(l.faisceaux) * melange(h));
+}
+
+/**
+	Retire une liaison de l'empreinte
+	@param c Cle de la liaison
+*/
+void ContentHash::oublie(const Cle &c) {
+	QHash<Cle, Liaison>::iterator it = liaisons.find(c);
+	if (it == liaisons.end()) return;
+	total -= it.value().empreinte;
+	liaisons_element.remove(it.value().e1, c);
+	liaisons_element.remove(it.value().e2, c);
+	liaisons_a_recalculer.remove(c);
+	liaisons.erase(it);
+}
+
+/**
+	@param a Premiere borne
+	@param b Seconde borne
+	@return La cle de la liaison entre les deux bornes, quel que soit leur ordre
+*/
+ContentHash::Cle ContentHash::cle(Terminal *a, Terminal *b) {
+	return(a < b ? qMakePair(a, b) : qMakePair(b, a));
+}
+
+/**
+	@param t Une borne
+	@return Le rang de la borne parmi celles de son element
+*/
+int ContentHash::rang(Terminal *t) {
+	int r = 0;
+	foreach(QGraphicsItem *qgi, t -> parentItem() -> childItems()) {
+		if (qgi == t) return(r);
+		if (qgraphicsitem_cast<Terminal *>(qgi)) ++ r;
+	}
+	return(-1);
+}
+
+/**
+	Fonction de melange sur 64 bits (finalisation de splitmix64)
+	@param x Valeur a melanger
+	@return La valeur melangee
+*/
+quint64 ContentHash::melange(quint64 x) {
+	x ^= x >> 30;
+	x *= Q_UINT64_C(0xbf58476d1ce4e5b9);
+	x ^= x >> 27;
+	x *= Q_UINT64_C(0x94d049bb133111eb);
+	x ^= x >> 31;
+	return(x);
+}
@@ -0,0 +1,55 @@
+#ifndef CONTENTHASH_H
+	#define CONTENTHASH_H
+	#include <QtCore>
+	class Element;
+	class Terminal;
+	/**
+		Empreinte canonique du contenu d'un schema : type, position ramenee a la
+		grille et orientation des elements, liaisons entre leurs bornes. Elle ne
+		depend ni de l'ordre des items dans la scene ni des identifiants des
+		bornes : deux schemas identiques ont la meme empreinte, quel que soit le
+		fichier dont ils ont ete charges.
+		L'empreinte est la somme des empreintes des elements et des liaisons, et
+		chacune est retiree puis ajoutee a nouveau lorsqu'elle change : seuls les
+		elements modifies depuis la derniere lecture, et leurs liaisons, sont
+		recalcules.
+	*/
+	class ContentHash {
+		public:
+		ContentHash();
+		void elementChanged(Element *);
+		void elementRemoved(Element *);
+		void linkAdded(Terminal *, Terminal *, bool = false);
+		void linkRemoved(Terminal *, Terminal *, bool = false);
+		void clear();
+		quint64 value();
+		
+		private:
+		/// liaison entre deux bornes, designees par leur element et leur rang
+		struct Liaison {
+			Element *e1;
+			int b1;
+			Element *e2;
+			int b2;
+			/// nombre de conducteurs et de liaisons de faisceaux entre les deux bornes
+			int conducteurs;
+			int faisceaux;
+			/// empreinte comptee dans le total
+			quint64 empreinte;
+		};
+		typedef QPair<Terminal *, Terminal *> Cle;
+		quint64 total;
+		/// empreinte de chaque element comptee dans le total
+		QHash<Element *, quint64> elements;
+		QHash<Cle, Liaison> liaisons;
+		/// liaisons de chaque element
+		QMultiHash<Element *, Cle> liaisons_element;
+		QSet<Element *> elements_a_recalculer;
+		QSet<Cle> liaisons_a_recalculer;
+		static Cle cle(Terminal *, Terminal *);
+		static int rang(Terminal *);
+		static quint64 melange(quint64);
+		quint64 empreinte(const Liaison &) const;
+		void oublie(const Cle &);
+	};
+#endif
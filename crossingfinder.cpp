@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <map>
+#include "crossingfinder.h"
+#include "conductor.h"
+
+/**
+	Decoupe une ligne brisee orthogonale en segments horizontaux et verticaux.
+	Les segments de longueur nulle et les segments obliques sont ignores.
+	@param t Sommets de la ligne brisee
+	@param proprietaire Numero a associer aux segments produits
+	@param h Liste a laquelle ajouter les segments horizontaux
+	@param v Liste a laquelle ajouter les segments verticaux
+*/
+void CrossingFinder::decompose(const QPolygonF &t, int proprietaire, QVector<Segment> &h, QVector<Segment> &v) {
+	for (int i = 1 ; i < t.size() ; ++ i) {
+		QPointF a = t.at(i - 1), b = t.at(i);
+		Segment s;
+		s.proprietaire = proprietaire;
+		s.p1 = QPointF(qMin(a.x(), b.x()), qMin(a.y(), b.y()));
+		s.p2 = QPointF(qMax(a.x(), b.x()), qMax(a.y(), b.y()));
+		if (a.y() == b.y() && a.x() != b.x()) h << s;
+		else if (a.x() == b.x() && a.y() != b.y()) v << s;
+	}
+}
+
+/// evenement de la ligne de balayage
+struct EvenementBalayage {
+	qreal x;
+	/// 0 : fin d'un segment horizontal, 1 : segment vertical, 2 : debut d'un segment horizontal
+	int genre;
+	int index;
+	bool operator<(const EvenementBalayage &e) const {
+		if (x != e.x) return(x < e.x);
+		return(genre < e.genre);
+	}
+};
+
+/**
+	Trouve tous les croisements entre des segments horizontaux et verticaux.
+	Seuls les croisements strictement interieurs aux deux segments sont
+	retenus : un coin ou un raccordement en T n'est pas un croisement.
+	@param h Segments horizontaux
+	@param v Segments verticaux
+	@return Les croisements trouves
+*/
+QVector<CrossingFinder::Croisement> CrossingFinder::sweep(const QVector<Segment> &h, const QVector<Segment> &v) {
+	QVector<Croisement> resultat;
+	if (h.isEmpty() || v.isEmpty()) return(resultat);
+
+	QVector<EvenementBalayage> evenements;
+	evenements.reserve(2 * h.size() + v.size());
+	for (int i = 0 ; i < h.size() ; ++ i) {
+		EvenementBalayage debut = { h.at(i).p1.x(), 2, i };
+		EvenementBalayage fin   = { h.at(i).p2.x(), 0, i };
+		evenements << debut << fin;
+	}
+	for (int i = 0 ; i < v.size() ; ++ i) {
+		EvenementBalayage e = { v.at(i).p1.x(), 1, i };
+		evenements << e;
+	}
+	// a abscisse egale, les segments horizontaux qui s'arretent sont retires et
+	// ceux qui commencent ne sont pas encore inseres lorsque les verticaux sont traites
+	std::sort(evenements.begin(), evenements.end());
+
+	typedef std::multimap<qreal, int> Actifs;
+	Actifs actifs;
+	QVector<Actifs::iterator> positions(h.size());
+	foreach(const EvenementBalayage &e, evenements) {
+		if (e.genre == 2) {
+			positions[e.index] = actifs.insert(std::make_pair(h.at(e.index).p1.y(), e.index));
+		} else if (e.genre == 0) {
+			actifs.erase(positions.at(e.index));
+		} else {
+			const Segment &s = v.at(e.index);
+			Actifs::iterator fin = actifs.lower_bound(s.p2.y());
+			for (Actifs::iterator it = actifs.upper_bound(s.p1.y()) ; it != fin ; ++ it) {
+				Croisement c;
+				c.horizontal = h.at(it -> second).proprietaire;
+				c.vertical   = s.proprietaire;
+				c.point      = QPointF(e.x, it -> first);
+				resultat << c;
+			}
+		}
+	}
+	return(resultat);
+}
+
+/**
+	Met a jour les croisements apres modification du trace de certains
+	conducteurs. Les croisements des conducteurs modifies sont oublies, puis
+	recherches a nouveau parmi les conducteurs voisins dans l'index spatial.
+	@param modifies Conducteurs dont le trace a change
+	@param index Index spatial des conducteurs du schema
+	@return Les conducteurs dont la liste de sauts a pu changer
+*/
+QSet<Conductor *> CrossingFinder::update(const QSet<Conductor *> &modifies, const SpatialIndex<Conductor *> &index) {
+	QSet<Conductor *> touches = modifies;
+	foreach(Conductor *c, modifies) {
+		foreach(const Lien &l, liens.value(c)) {
+			if (modifies.contains(l.autre)) continue;
+			oublie(l.autre, c);
+			touches << l.autre;
+		}
+		liens.remove(c);
+	}
+
+	// conducteurs modifies puis voisins, numerotes dans cet ordre
+	QVector<Conductor *> table;
+	foreach(Conductor *c, modifies) table << c;
+	int nb_modifies = table.size();
+	QSet<Conductor *> voisins;
+	foreach(Conductor *c, modifies) {
+		foreach(Conductor *v, index.query(index.rect(c))) {
+			if (!modifies.contains(v) && !voisins.contains(v)) {
+				voisins << v;
+				table << v;
+			}
+		}
+	}
+
+	QVector<Segment> h_modifies, v_modifies, h_voisins, v_tous;
+	for (int i = 0 ; i < table.size() ; ++ i) {
+		if (i < nb_modifies) decompose(table.at(i) -> polyline(), i, h_modifies, v_modifies);
+		else decompose(table.at(i) -> polyline(), i, h_voisins, v_tous);
+	}
+	v_tous += v_modifies;
+
+	// les croisements entre deux voisins n'ont pas change : ils ne sont pas recherches
+	QVector<Croisement> croisements = sweep(h_modifies, v_tous);
+	croisements += sweep(h_voisins, v_modifies);
+	foreach(const Croisement &x, croisements) {
+		if (x.horizontal == x.vertical) continue;
+		Conductor *ch = table.at(x.horizontal);
+		Conductor *cv = table.at(x.vertical);
+		Lien saut  = { cv, x.point, true };
+		Lien passe = { ch, x.point, false };
+		liens[ch] << saut;
+		liens[cv] << passe;
+		touches << ch << cv;
+	}
+	return(touches);
+}
+
+/**
+	Oublie tous les croisements d'un conducteur retire du schema
+	@param c Le conducteur retire
+	@return Les conducteurs qui le croisaient
+*/
+QSet<Conductor *> CrossingFinder::remove(Conductor *c) {
+	QSet<Conductor *> touches;
+	foreach(const Lien &l, liens.value(c)) {
+		oublie(l.autre, c);
+		touches << l.autre;
+	}
+	liens.remove(c);
+	touches.remove(c);
+	return(touches);
+}
+
+/**
+	@param c Un conducteur
+	@return Les points, en coordonnees de la scene, ou le conducteur doit sauter
+	par-dessus un autre conducteur
+*/
+QList<QPointF> CrossingFinder::jumps(Conductor *c) const {
+	QList<QPointF> sauts;
+	foreach(const Lien &l, liens.value(c)) if (l.saut) sauts << l.point;
+	return(sauts);
+}
+
+/**
+	Retire de la liste des croisements d'un conducteur ceux qui concernent un autre
+	@param c Le conducteur dont la liste est modifiee
+	@param autre Le conducteur a oublier
+*/
+void CrossingFinder::oublie(Conductor *c, Conductor *autre) {
+	QHash<Conductor *, QVector<Lien> >::iterator it = liens.find(c);
+	if (it == liens.end()) return;
+	QVector<Lien> &liste = it.value();
+	for (int i = liste.size() - 1 ; i >= 0 ; -- i) {
+		if (liste.at(i).autre == autre) liste.remove(i);
+	}
+	if (liste.isEmpty()) liens.erase(it);
+}
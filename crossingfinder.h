@@ -0,0 +1,50 @@
+#ifndef CROSSINGFINDER_H
+	#define CROSSINGFINDER_H
+	#include <QtCore>
+	#include "spatialindex.h"
+	class Conductor;
+	/**
+		Recherche des croisements entre les segments horizontaux et verticaux
+		des conducteurs, par balayage : les segments horizontaux sont ranges par
+		ordonnee dans un arbre equilibre pendant que la ligne de balayage les
+		traverse, et chaque segment vertical n'interroge que l'intervalle
+		d'ordonnees qu'il couvre. Le cout est en O((n + k) log n) pour n segments
+		et k croisements.
+		Les croisements sont tenus a jour de facon incrementale : seuls les
+		conducteurs modifies et leurs voisins dans l'index spatial sont balayes.
+		Par convention, le saut est dessine par le conducteur dont le segment est
+		horizontal.
+	*/
+	class CrossingFinder {
+		public:
+		/// segment horizontal ou vertical, p1 ayant les plus petites coordonnees
+		struct Segment {
+			int proprietaire;
+			QPointF p1;
+			QPointF p2;
+		};
+		/// croisement entre un segment horizontal et un segment vertical
+		struct Croisement {
+			int horizontal;
+			int vertical;
+			QPointF point;
+		};
+		static void decompose(const QPolygonF &, int, QVector<Segment> &, QVector<Segment> &);
+		static QVector<Croisement> sweep(const QVector<Segment> &, const QVector<Segment> &);
+
+		QSet<Conductor *> update(const QSet<Conductor *> &, const SpatialIndex<Conductor *> &);
+		QSet<Conductor *> remove(Conductor *);
+		QList<QPointF> jumps(Conductor *) const;
+		void clear() { liens.clear(); }
+
+		private:
+		/// croisement vu depuis l'un des deux conducteurs concernes
+		struct Lien {
+			Conductor *autre;
+			QPointF point;
+			bool saut;
+		};
+		QHash<Conductor *, QVector<Lien> > liens;
+		void oublie(Conductor *, Conductor *);
+	};
+#endif
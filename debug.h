@@ -4,8 +4,10 @@
 #ifndef DEBUG_H__
 #define DEBUG_H__
 
+#ifdef _WIN32
 #include <crtdbg.h>
 #include <windows.h>
+#endif
 #include <cstddef>
 #include <list>
 #include <map>
@@ -16,6 +18,11 @@
 
 
 
+#ifdef _WIN32
 #define trace_msg(stream_args) do { std::stringstream s; s <<  __FILE__ << "(" << __LINE__ <<  ") : " << __FUNCTION__ << " " << stream_args << "\n"; OutputDebugStringA (s.str().c_str()); } while (0)
+#else
+// hors de Windows (outil en ligne de commande notamment), les traces sont ignorees
+#define trace_msg(stream_args) do {} while (0)
+#endif
 
 #endif
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "destructionqueue.h"
+
+/**
+	Constructeur
+	@param parent QObject parent
+*/
+DestructionQueue::DestructionQueue(QObject *parent) : QObject(parent), prochain(0) {
+	// intervalle nul : une tranche chaque fois que la boucle d'evenements est libre
+	minuterie.setInterval(0);
+	connect(&minuterie, SIGNAL(timeout()), this, SLOT(destroySlice()));
+}
+
+/**
+	Destructeur : les items encore dans la file, retenus ou non, sont detruits
+*/
+DestructionQueue::~DestructionQueue() {
+	foreach(QGraphicsItem *qgi, items) delete qgi;
+}
+
+/**
+	Confie un item a la file ; il doit avoir ete retire de sa scene
+	@param qgi L'item a detruire
+*/
+void DestructionQueue::add(QGraphicsItem *qgi) {
+	if (items.contains(qgi)) return;
+	items.insert(qgi);
+	a_detruire << qgi;
+	if (!minuterie.isActive()) minuterie.start();
+}
+
+/**
+	Confie des items a la file
+	@param liste Les items a detruire
+*/
+void DestructionQueue::add(const QList<QGraphicsItem *> &liste) {
+	foreach(QGraphicsItem *qgi, liste) add(qgi);
+}
+
+/**
+	Reprend un item qui n'a pas encore ete detruit, par exemple pour le
+	remettre dans sa scene
+	@param qgi L'item a reprendre
+	@return true si l'item etait dans la file, false s'il n'y est pas (ou plus)
+*/
+bool DestructionQueue::take(QGraphicsItem *qgi) {
+	retenus.remove(qgi);
+	return(items.remove(qgi));
+}
+
+/**
+	Retient un item de la file : il ne sera pas detruit avant d'etre relache
+	@param qgi Un item de la file
+*/
+void DestructionQueue::retain(QGraphicsItem *qgi) {
+	if (items.contains(qgi)) retenus.insert(qgi);
+}
+
+/**
+	Relache un item retenu : il sera detruit avec les suivants
+	@param qgi Un item retenu
+*/
+void DestructionQueue::release(QGraphicsItem *qgi) {
+	if (!retenus.remove(qgi)) return;
+	a_detruire << qgi;
+	if (!minuterie.isActive()) minuterie.start();
+}
+
+/**
+	Detruit immediatement tous les items de la file qui ne sont pas retenus
+*/
+void DestructionQueue::flush() {
+	for ( ; prochain < a_detruire.size() ; ++ prochain) {
+		QGraphicsItem *qgi = a_detruire.at(prochain);
+		if (!items.contains(qgi) || retenus.contains(qgi)) continue;
+		items.remove(qgi);
+		delete qgi;
+	}
+	a_detruire.clear();
+	prochain = 0;
+	minuterie.stop();
+}
+
+/**
+	Detruit des items jusqu'a epuisement de la file ou du budget de la tranche
+*/
+void DestructionQueue::destroySlice() {
+	QElapsedTimer chrono;
+	chrono.start();
+	while (prochain < a_detruire.size()) {
+		QGraphicsItem *qgi = a_detruire.at(prochain ++);
+		// item repris ou retenu depuis son arrivee
+		if (!items.contains(qgi) || retenus.contains(qgi)) continue;
+		items.remove(qgi);
+		delete qgi;
+		if (chrono.elapsed() >= BUDGET_DESTRUCTION) return;
+	}
+	a_detruire.clear();
+	prochain = 0;
+	minuterie.stop();
+}
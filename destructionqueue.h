@@ -0,0 +1,42 @@
+#ifndef DESTRUCTIONQUEUE_H
+	#define DESTRUCTIONQUEUE_H
+	#include <QtWidgets>
+	/// duree maximale, en millisecondes, d'une tranche de destruction
+	#define BUDGET_DESTRUCTION 8
+	/**
+		File de destruction differee des items retires d'une scene. Les items
+		sont detruits par tranches dont la duree est limitee, lorsque la boucle
+		d'evenements est libre : la suppression d'un grand nombre d'items ne
+		bloque pas l'interface.
+		Un item retenu (par exemple pour pouvoir annuler sa suppression) n'est
+		pas detruit tant qu'il n'est pas relache ; un item repris avec take()
+		n'appartient plus a la file.
+	*/
+	class DestructionQueue : public QObject {
+		Q_OBJECT
+		public:
+		DestructionQueue(QObject * = 0);
+		~DestructionQueue();
+		void add(QGraphicsItem *);
+		void add(const QList<QGraphicsItem *> &);
+		bool take(QGraphicsItem *);
+		void retain(QGraphicsItem *);
+		void release(QGraphicsItem *);
+		int size() const { return(items.size()); }
+		
+		public slots:
+		void flush();
+		
+		private slots:
+		void destroySlice();
+		
+		private:
+		/// items appartenant a la file
+		QSet<QGraphicsItem *> items;
+		/// items a detruire, dans l'ordre d'arrivee ; ceux qui ont quitte la file sont ignores
+		QVector<QGraphicsItem *> a_detruire;
+		int prochain;
+		QSet<QGraphicsItem *> retenus;
+		QTimer minuterie;
+	};
+#endif
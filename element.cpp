@@ -1,5 +1,7 @@
 #include "element.h"
 #include "schema.h"
+#include "groupmove.h"
+#include "paintstats.h"
 #include <QtDebug>
 #include "debug.h"
 /*** Methodes publiques ***/
@@ -9,6 +11,7 @@
 */
 Element::Element(QGraphicsItem *parent, Schema *scene) : QGraphicsItem(parent) {
 	sens = true;
+	dans_schema = false;
 	peut_relier_ses_propres_bornes = false;
 }
 
@@ -19,11 +22,13 @@ Element::Element(QGraphicsItem *parent, Schema *scene) : QGraphicsItem(parent) {
 	@param widget  Le widget sur lequel on dessine
 */
 void Element::paint(QPainter *painter, const QStyleOptionGraphicsItem *options, QWidget *) {
+	PAINTSTATS_COUNT(elements);
 	// Dessin de l'element lui-meme
 	paint(painter, options);
 	
-	// Dessin du cadre de selection si necessaire
-	if (isSelected()) drawSelection(painter, options);
+	// Dessin du cadre de selection si necessaire ; sur un Schema, les cadres de
+	// selection sont dessines en une seule passe par la surcouche de selection
+	if (isSelected() && !dans_schema) drawSelection(painter, options);
 }
 
 /**
@@ -102,10 +107,29 @@ QPixmap Element::pixmap() {
 	@todo distinguer les bornes avec un cast dynamique
 */
 QVariant Element::itemChange(GraphicsItemChange change, const QVariant &value) {
-	if (change == QGraphicsItem::ItemPositionChange || change == QGraphicsItem::ItemSelectedChange) {
-		foreach(QGraphicsItem *qgi, childItems()) {
-			if (Terminal *p = qgraphicsitem_cast<Terminal *>(qgi)) p -> updateConducteur();
+	// les conducteurs sont marques a recalculer une fois le deplacement effectue
+	if (change == QGraphicsItem::ItemPositionHasChanged || change == QGraphicsItem::ItemTransformHasChanged) {
+		updateConducteurs();
+		if (Schema *s = qobject_cast<Schema *>(scene())) s -> elementGeometryChanged(this);
+	}
+	
+	// tient a jour la surcouche de selection du Schema
+	if (change == QGraphicsItem::ItemSelectedHasChanged) {
+		if (Schema *s = qobject_cast<Schema *>(scene())) s -> elementSelectionChanged(this, value.toBool());
+	} else if (change == QGraphicsItem::ItemSceneChange) {
+		// l'element quitte son schema
+		if (Schema *s = qobject_cast<Schema *>(scene())) {
+			s -> elementSelectionChanged(this, false);
+			s -> elementRemoved(this);
 		}
+	} else if (change == QGraphicsItem::ItemSceneHasChanged) {
+		Schema *s = qobject_cast<Schema *>(scene());
+		dans_schema = (s != 0);
+		if (s) s -> elementGeometryChanged(this);
+		if (s && isSelected()) s -> elementSelectionChanged(this, true);
+	}
+	if ((change == QGraphicsItem::ItemPositionChange || change == QGraphicsItem::ItemPositionHasChanged) && isSelected()) {
+		if (Schema *s = qobject_cast<Schema *>(scene())) s -> invalidateSelection(sceneBoundingRect());
 	}
 	return(QGraphicsItem::itemChange(change, value));
 }
@@ -221,7 +245,15 @@ void Element::setPos(const QPointF &p) {
 		int p_y = qRound(p.y() / 10.0) * 10;
 		QGraphicsItem::setPos(p_x, p_y);
 	} else QGraphicsItem::setPos(p);
-	// actualise les bornes / conducteurs
+	// sans ItemSendsGeometryChanges, itemChange n'est pas appele : les bornes /
+	// conducteurs sont alors actualises ici
+	if (!(flags() & ItemSendsGeometryChanges)) updateConducteurs();
+}
+
+/**
+	Marque a recalculer les conducteurs relies aux bornes de l'element
+*/
+void Element::updateConducteurs() {
 	foreach(QGraphicsItem *qgi, childItems()) {
 		if (Terminal *p = qgraphicsitem_cast<Terminal *>(qgi)) p -> updateConducteur();
 	}
@@ -237,6 +269,18 @@ void Element::setPos(qreal x, qreal y) {
 	setPos(QPointF(x, y));
 }
 
+/**
+	Gere le clic sur l'element : sur un Schema, un deplacement groupe de la
+	selection commence
+	@param e Evenement decrivant le clic
+*/
+void Element::mousePressEvent(QGraphicsSceneMouseEvent *e) {
+	// la selection est mise a jour avant d'etre photographiee
+	QGraphicsItem::mousePressEvent(e);
+	if (e -> button() != Qt::LeftButton) return;
+	if (Schema *s = qobject_cast<Schema *>(scene())) s -> beginGroupMove();
+}
+
 /**
 	Gere les mouvements de souris lies a l'element, notamment
 */
@@ -247,6 +291,13 @@ void Element::mouseMoveEvent(QGraphicsSceneMouseEvent *e) {
 	
 	/*&& (flags() & ItemIsMovable)*/ // on le sait qu'il est movable
 	if (e -> buttons() & Qt::LeftButton) {
+		// sur un Schema, la selection photographiee au clic est deplacee d'un seul bloc
+		Schema *s = qobject_cast<Schema *>(scene());
+		if (s && s -> groupMove()) {
+			s -> groupMove() -> moveBy(e -> scenePos() - e -> buttonDownScenePos(Qt::LeftButton));
+			return;
+		}
+		
 		QPointF oldPos = pos();
 		setPos(mapToParent(e->pos()) - matrix().map(e->buttonDownPos(Qt::LeftButton)));
 		QPointF diff = pos() - oldPos;
@@ -267,6 +318,18 @@ void Element::mouseMoveEvent(QGraphicsSceneMouseEvent *e) {
 	} else e -> ignore();
 }
 
+/**
+	Gere le relachement de la souris : le deplacement groupe en cours est
+	termine
+	@param e Evenement decrivant le relachement
+*/
+void Element::mouseReleaseEvent(QGraphicsSceneMouseEvent *e) {
+	if (e -> button() == Qt::LeftButton) {
+		if (Schema *s = qobject_cast<Schema *>(scene())) s -> endGroupMove();
+	}
+	QGraphicsItem::mouseReleaseEvent(e);
+}
+
 /**
 	Permet de savoir si un element XML (QDomElement) represente bien un element
 	@param e Le QDomElement a valide
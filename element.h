@@ -35,13 +35,17 @@
 		
 		protected:
 		void drawAxes(QPainter *, const QStyleOptionGraphicsItem *);
+		void mousePressEvent(QGraphicsSceneMouseEvent *);
 		void mouseMoveEvent(QGraphicsSceneMouseEvent *);
+		void mouseReleaseEvent(QGraphicsSceneMouseEvent *);
 		bool peut_relier_ses_propres_bornes;
 		
 		private:
 		void drawSelection(QPainter *, const QStyleOptionGraphicsItem *);
+		void updateConducteurs();
 		void updatePixmap();
 		bool    sens;
+		bool    dans_schema; // booleen indiquant si la selection est dessinee par le Schema
 		QSize   dimensions;
 		QPoint  hotspot_coord;
 		QPixmap apercu;
@@ -0,0 +1,228 @@
+#include "elementdefinition.h"
+
+QHash<QString, ElementDefinition *> ElementDefinition::cache;
+QReadWriteLock ElementDefinition::verrou_cache;
+
+/**
+	Retourne la definition decrite par un fichier *.elmt. Le fichier n'est
+	analyse que lors du premier appel ; les appels suivants retournent la
+	definition conservee dans le cache. Cette methode peut etre appelee depuis
+	plusieurs threads.
+	@param nom_fichier Chemin du fichier de definition
+	@return La definition, jamais nulle : en cas d'echec, etat() indique l'erreur
+*/
+const ElementDefinition *ElementDefinition::get(const QString &nom_fichier) {
+	QString cle = QDir::cleanPath(nom_fichier);
+	{
+		QReadLocker lecture(&verrou_cache);
+		if (ElementDefinition *definition = cache.value(cle)) return(definition);
+	}
+	// l'analyse est faite hors du verrou ; si deux threads analysent le meme
+	// fichier en meme temps, seule la premiere definition est conservee
+	ElementDefinition *definition = new ElementDefinition(cle);
+	QWriteLocker ecriture(&verrou_cache);
+	if (ElementDefinition *existante = cache.value(cle)) {
+		delete definition;
+		return(existante);
+	}
+	cache.insert(cle, definition);
+	return(definition);
+}
+
+/**
+	Charge dans le cache toutes les definitions d'un dossier. Apres cet appel,
+	les threads qui instancient des elements de ce dossier ne font plus que lire
+	le cache.
+	@param dossier Dossier contenant les fichiers *.elmt
+	@return Le nombre de definitions valides chargees
+*/
+int ElementDefinition::preload(const QString &dossier) {
+	int nb_definitions = 0;
+	QDir dossier_elements(dossier);
+	QStringList filtres;
+	filtres << "*.elmt";
+	foreach(QString fichier, dossier_elements.entryList(filtres, QDir::Files, QDir::Name)) {
+		if (!get(dossier_elements.filePath(fichier)) -> etat()) ++ nb_definitions;
+	}
+	return(nb_definitions);
+}
+
+/**
+	Analyse un fichier de definition d'element
+	@param nom_fichier Chemin du fichier de definition
+*/
+ElementDefinition::ElementDefinition(const QString &nom_fichier) {
+	// pessimisme inside : par defaut, ca foire
+	def_etat = -1;
+	def_largeur = 0;
+	def_hauteur = 0;
+
+	// The file must exist
+	if (!QFileInfo(nom_fichier).exists()) {
+		def_etat = 1;
+		return;
+	}
+
+	// The file must be readable
+	QFile file(nom_fichier);
+	if (!file.open(QIODevice::ReadOnly)) {
+		def_etat = 2;
+		return;
+	}
+
+ // the file must be an XML document
+	QDomDocument document_xml;
+	if (!document_xml.setContent(&file)) {
+		def_etat = 3;
+		return;
+	}
+
+ // the root is assumed to be an element definition
+	QDomElement root = document_xml.documentElement();
+	if (root.tagName() != "definition" || root.attribute("type") != "element") {
+		def_etat = 4;
+		return;
+	}
+
+ // these attributes must be present and valid
+	int w, h, hot_x, hot_y;
+	if (
+		root.attribute("nom") == QString("") ||\
+		!attributeIsAnInteger(root, QString("width"), &w) ||\
+		!attributeIsAnInteger(root, QString("height"), &h) ||\
+		!attributeIsAnInteger(root, QString("hotspot_x"), &hot_x) ||\
+		!attributeIsAnInteger(root, QString("hotspot_y"), &hot_y)
+	) {
+		def_etat = 5;
+		return;
+	}
+
+ // we can already specify the name, size and hotspot
+	def_nom = root.attribute("nom");
+	def_largeur = w;
+	def_hauteur = h;
+	def_hotspot = QPoint(hot_x, hot_y);
+
+ // the definition is assumed to have children
+	if (root.firstChild().isNull()) {
+		def_etat = 6;
+		return;
+	}
+
+ // path of the children of the definition
+	int nb_elements_parses = 0;
+	QPainter qp;
+	qp.begin(&def_dessin);
+	QPen t;
+	t.setColor(Qt::black);
+	t.setWidthF(1.0);
+	t.setJoinStyle(Qt::MiterJoin);
+	qp.setPen(t);
+	for (QDomNode node = root.firstChild() ; !node.isNull() ; node = node.nextSibling()) {
+		QDomElement elmts = node.toElement();
+		if(elmts.isNull()) continue;
+		if (parseElement(elmts, qp)) ++ nb_elements_parses;
+		else {
+			def_etat = 7;
+			return;
+		}
+	}
+	qp.end();
+
+ // there must be at least one loaded element
+	if (!nb_elements_parses) {
+		def_etat = 8;
+		return;
+	}
+
+	// fermeture du file
+	file.close();
+
+	def_etat = 0;
+}
+
+bool ElementDefinition::parseElement(QDomElement &e, QPainter &qp) {
+	if (e.tagName() == "borne") return(parseBorne(e));
+	else if (e.tagName() == "ligne") return(parseLigne(e, qp));
+	else if (e.tagName() == "cercle") return(parseCercle(e, qp));
+	else if (e.tagName() == "polygone") return(parsePolygone(e, qp));
+	else return(true);	// on n'est pas chiant, on ignore l'element inconnu
+}
+
+bool ElementDefinition::parseLigne(QDomElement &e, QPainter &qp) {
+ // check the presence and validity of mandatory attributes
+	int x1, y1, x2, y2;
+	if (!attributeIsAnInteger(e, QString("x1"), &x1)) return(false);
+	if (!attributeIsAnInteger(e, QString("y1"), &y1)) return(false);
+	if (!attributeIsAnInteger(e, QString("x2"), &x2)) return(false);
+	if (!attributeIsAnInteger(e, QString("y2"), &y2)) return(false);
+	/// @todo : gerer l'antialiasing (mieux que ca !) et le type de trait
+	setQPainterAntiAliasing(&qp, e.attribute("antialias") == "true");
+	qp.drawLine(x1, y1, x2, y2);
+	return(true);
+}
+
+bool ElementDefinition::parseCercle(QDomElement &e, QPainter &qp) {
+
+	// check the presence of mandatory attributes
+	int cercle_x, cercle_y, cercle_r;
+	if (!attributeIsAnInteger(e, QString("x"),     &cercle_x)) return(false);
+	if (!attributeIsAnInteger(e, QString("y"),     &cercle_y)) return(false);
+	if (!attributeIsAnInteger(e, QString("rayon"), &cercle_r)) return(false);
+ /// @todo: manage antialiasing (better than that!) and type of line
+	setQPainterAntiAliasing(&qp, e.attribute("antialias") == "true");
+	qp.drawEllipse(cercle_x, cercle_y, cercle_r, cercle_r);
+	return(true);
+}
+
+bool ElementDefinition::parsePolygone(QDomElement &e, QPainter &qp) {
+	int i = 1;
+	while(true) {
+		if (attributeIsAnInteger(e, QString("x%1").arg(i)) && attributeIsAnInteger(e, QString("y%1").arg(i))) ++ i;
+		else break;
+	}
+	if (i < 3) return(false);
+	//QPointF points[i-1];
+	QPolygonF qpf(i - 1);
+	for (int j = 1 ; j < i ; ++ j) {
+		qpf.push_back( QPointF(
+			e.attribute(QString("x%1").arg(j)).toDouble(),
+			e.attribute(QString("y%1").arg(j)).toDouble()
+		));
+	}
+	setQPainterAntiAliasing(&qp, e.attribute("antialias") == "true");
+	qp.drawPolygon(qpf);
+	return(true);
+}
+
+bool ElementDefinition::parseBorne(QDomElement &e) {
+ // check the presence and validity of mandatory attributes
+	Borne borne;
+	if (!attributeIsAnInteger(e, QString("x"), &borne.x)) return(false);
+	if (!attributeIsAnInteger(e, QString("y"), &borne.y)) return(false);
+	if (!e.hasAttribute("orientation")) return(false);
+	if (e.attribute("orientation") == "n") borne.orientation = Terminal::Nord;
+	else if (e.attribute("orientation") == "s") borne.orientation = Terminal::Sud;
+	else if (e.attribute("orientation") == "e") borne.orientation = Terminal::Est;
+	else if (e.attribute("orientation") == "o") borne.orientation = Terminal::Ouest;
+	else return(false);
+	def_bornes << borne;
+	return(true);
+}
+
+void ElementDefinition::setQPainterAntiAliasing(QPainter *qp, bool aa) {
+	qp -> setRenderHint(QPainter::Antialiasing,          aa);
+	qp -> setRenderHint(QPainter::TextAntialiasing,      aa);
+	qp -> setRenderHint(QPainter::SmoothPixmapTransform, aa);
+}
+
+int ElementDefinition::attributeIsAnInteger(QDomElement &e, QString nom_attribut, int *entier) {
+ // check the presence of the attribute
+	if (!e.hasAttribute(nom_attribut)) return(false);
+ // check the validity of the attribute
+	bool ok;
+	int tmp = e.attribute(nom_attribut).toInt(&ok);
+	if (!ok) return(false);
+	if (entier != NULL) *entier = tmp;
+	return(true);
+}
@@ -0,0 +1,55 @@
+#ifndef ELEMENTDEFINITION_H
+	#define ELEMENTDEFINITION_H
+	#include <QtWidgets>
+	#include <QtXml/QtXml>
+	#include "terminal.h"
+	/**
+		Definition d'un element personnalise, telle que decrite par un fichier
+		*.elmt : nom, dimensions, hotspot, dessin et bornes.
+		Chaque fichier n'est analyse qu'une seule fois par processus : les
+		definitions sont conservees dans un cache partage par tous les
+		ElementPerso, y compris lorsqu'ils sont crees depuis plusieurs threads.
+		Une definition n'est plus jamais modifiee une fois dans le cache.
+	*/
+	class ElementDefinition {
+		public:
+		/// borne decrite par la definition
+		struct Borne {
+			int x;
+			int y;
+			Terminal::Orientation orientation;
+		};
+
+		static const ElementDefinition *get(const QString &);
+		static int preload(const QString &);
+
+		int etat() const { return(def_etat); }
+		QString nom() const { return(def_nom); }
+		int largeur() const { return(def_largeur); }
+		int hauteur() const { return(def_hauteur); }
+		QPoint hotspot() const { return(def_hotspot); }
+		const QPicture &dessin() const { return(def_dessin); }
+		const QList<Borne> &bornes() const { return(def_bornes); }
+
+		private:
+		ElementDefinition(const QString &);
+		int def_etat; // code d'erreur de l'analyse, 0 si la definition est valide
+		QString def_nom;
+		int def_largeur;
+		int def_hauteur;
+		QPoint def_hotspot;
+		QPicture def_dessin;
+		QList<Borne> def_bornes;
+
+		bool parseElement(QDomElement &, QPainter &);
+		bool parseLigne(QDomElement &, QPainter &);
+		bool parseCercle(QDomElement &, QPainter &);
+		bool parsePolygone(QDomElement &, QPainter &);
+		bool parseBorne(QDomElement &);
+		static void setQPainterAntiAliasing(QPainter *, bool);
+		static int attributeIsAnInteger(QDomElement &, QString, int * = NULL);
+
+		static QHash<QString, ElementDefinition *> cache;
+		static QReadWriteLock verrou_cache;
+	};
+#endif
@@ -18,13 +18,6 @@
 		QString priv_nom;
 		QString nomfichier;
 		QPicture dessin;
-		bool parseElement(QDomElement &, QPainter &, Schema *);
-		bool parseLigne(QDomElement &, QPainter &);
-		bool parseCercle(QDomElement &, QPainter &);
-		bool parsePolygone(QDomElement &, QPainter &);
-		bool parseBorne(QDomElement &, Schema *);
-		void setQPainterAntiAliasing(QPainter *, bool);
-		int attributeIsAnInteger(QDomElement &, QString, int * = NULL);
 		int nb_bornes;
 	};
 #endif
@@ -0,0 +1,417 @@
+#include <algorithm>
+#include "ercchecker.h"
+#include "schema.h"
+#include "element.h"
+#include "conductor.h"
+#include "spatialindex.h"
+
+/// delai de regroupement des modifications, en millisecondes
+#define DELAI_ERC 150
+/// au-dela de ce nombre de zones modifiees, elles sont fusionnees en une seule
+#define MAX_ZONES_ERC 256
+
+/**
+	Instantane d'une partie du schema, ne contenant que des valeurs : il peut
+	etre lu par le thread de verification pendant que la scene est modifiee.
+*/
+struct ErcChecker::Instantane {
+	struct Borne {
+		QPointF point;
+		int reseau;
+		bool reliee;
+	};
+	struct Elmt {
+		quintptr id;
+		QRectF rect;
+		QString nom;
+		QVector<Borne> bornes;
+		/// false si l'element n'est la que comme obstacle pour les conducteurs
+		bool verifie;
+	};
+	struct Fil {
+		quintptr id;
+		QPolygonF trajet;
+		/// elements portant les bornes du conducteur
+		quintptr bout1;
+		quintptr bout2;
+	};
+	int generation;
+	QVector<QRectF> zones;
+	bool tout;
+	QVector<Elmt> elements;
+	QVector<Fil> conducteurs;
+};
+
+/**
+	Resultat de la verification d'un instantane : difference avec les constats
+	precedents
+*/
+struct ErcChecker::Resultat {
+	int generation;
+	/// identifiants des constats retires
+	QVector<int> retires;
+	/// constats ajoutes, par identifiant
+	QHash<int, Constat> ajoutes;
+};
+
+/**
+	Thread de verification : il traite les instantanes dans l'ordre ou ils lui
+	sont confies. Il garde sa propre copie des constats, indexee par item et
+	par zone, pour ne transmettre que les differences.
+*/
+class ErcChecker::Worker : public QThread {
+	public:
+	Worker() : arret(false), generation_suivie(-1), prochain_id(0) {}
+	~Worker() {
+		{
+			QMutexLocker verrouillage(&verrou);
+			arret = true;
+			condition.wakeAll();
+		}
+		wait();
+	}
+	void soumet(const Instantane &i) {
+		QMutexLocker verrouillage(&verrou);
+		a_verifier.enqueue(i);
+		condition.wakeAll();
+	}
+	bool resultat(Resultat *r) {
+		QMutexLocker verrouillage(&verrou);
+		if (resultats.isEmpty()) return(false);
+		*r = resultats.dequeue();
+		return(true);
+	}
+	/// objet du thread principal a prevenir lorsqu'un resultat est disponible
+	QObject *destinataire;
+	protected:
+	void run() {
+		forever {
+			Instantane instantane;
+			{
+				QMutexLocker verrouillage(&verrou);
+				while (a_verifier.isEmpty() && !arret) condition.wait(&verrou);
+				if (arret) return;
+				instantane = a_verifier.dequeue();
+			}
+			Resultat r = integre(instantane, verifie(instantane));
+			{
+				QMutexLocker verrouillage(&verrou);
+				resultats.enqueue(r);
+			}
+			QMetaObject::invokeMethod(destinataire, "collectResults", Qt::QueuedConnection);
+		}
+	}
+	private:
+	QMutex verrou;
+	QWaitCondition condition;
+	QQueue<Instantane> a_verifier;
+	QQueue<Resultat> resultats;
+	bool arret;
+	/// constats d'un instantane, avant comparaison avec les precedents
+	struct Verification {
+		/// items verifies : leurs anciens constats sont remplaces
+		QSet<quintptr> sujets;
+		QList<Constat> constats;
+	};
+	static Verification verifie(const Instantane &);
+	Resultat integre(const Instantane &, const Verification &);
+	static QString cle(const Constat &);
+	// constats connus du thread de verification, pour la generation suivie
+	int generation_suivie;
+	int prochain_id;
+	QHash<int, Constat> suivis;
+	QMultiHash<quintptr, int> suivis_par_sujet;
+	SpatialIndex<int> index_suivis;
+};
+
+/**
+	Applique les regles a un instantane
+	@param i L'instantane a verifier
+	@return Les constats, et la liste des items verifies
+*/
+ErcChecker::Worker::Verification ErcChecker::Worker::verifie(const Instantane &i) {
+	Verification r;
+
+	SpatialIndex<int> obstacles;
+	for (int k = 0 ; k < i.elements.size() ; ++ k) {
+		const Instantane::Elmt &e = i.elements.at(k);
+		obstacles.insert(k, e.rect);
+		if (!e.verifie) continue;
+		r.sujets << e.id;
+		for (int b = 0 ; b < e.bornes.size() ; ++ b) {
+			const Instantane::Borne &borne = e.bornes.at(b);
+			if (!borne.reliee) {
+				Constat c = {
+					BorneLibre, e.id, QRectF(borne.point - QPointF(3.0, 3.0), QSizeF(6.0, 6.0)),
+					QObject::tr("Borne %1 de %2 non reliee").arg(b + 1).arg(e.nom)
+				};
+				r.constats << c;
+				continue;
+			}
+			for (int b2 = 0 ; b2 < b ; ++ b2) {
+				if (e.bornes.at(b2).reliee && e.bornes.at(b2).reseau == borne.reseau) {
+					Constat c = {
+						CourtCircuit, e.id, e.rect,
+						QObject::tr("Bornes %1 et %2 de %3 court-circuitees").arg(b2 + 1).arg(b + 1).arg(e.nom)
+					};
+					r.constats << c;
+					break;
+				}
+			}
+		}
+	}
+
+	foreach(const Instantane::Fil &f, i.conducteurs) {
+		r.sujets << f.id;
+		QSet<int> traverses;
+		for (int s = 1 ; s < f.trajet.size() ; ++ s) {
+			QRectF segment = QRectF(f.trajet.at(s - 1), f.trajet.at(s)).normalized();
+			foreach(int k, obstacles.query(segment)) {
+				// les elements du conducteur, dont les bornes sont a l'interieur, ne comptent pas
+				if (i.elements.at(k).id == f.bout1 || i.elements.at(k).id == f.bout2) continue;
+				// les bords des autres elements non plus
+				QRectF interieur = i.elements.at(k).rect.adjusted(1.0, 1.0, -1.0, -1.0);
+				if (!SpatialIndex<int>::chevauche(segment, interieur) || traverses.contains(k)) continue;
+				traverses << k;
+				Constat c = {
+					ConducteurSurElement, f.id, segment.intersected(i.elements.at(k).rect),
+					QObject::tr("Conducteur passant sur %1").arg(i.elements.at(k).nom)
+				};
+				r.constats << c;
+			}
+		}
+	}
+	return(r);
+}
+
+/**
+	Compare les constats d'un instantane aux constats connus : les constats des
+	items verifies et ceux des zones verifiees sont remplaces, ceux qui sont
+	retrouves a l'identique gardent leur identifiant.
+	@param i L'instantane verifie
+	@param v Les constats de l'instantane
+	@return Les constats retires et ajoutes
+*/
+ErcChecker::Resultat ErcChecker::Worker::integre(const Instantane &i, const Verification &v) {
+	Resultat r;
+	r.generation = i.generation;
+	if (i.generation != generation_suivie) {
+		suivis.clear();
+		suivis_par_sujet.clear();
+		index_suivis.clear();
+		generation_suivie = i.generation;
+	}
+	
+	QSet<int> remplaces;
+	if (i.tout) remplaces = QSet<int>::fromList(suivis.keys());
+	else {
+		foreach(quintptr s, v.sujets) foreach(int id, suivis_par_sujet.values(s)) remplaces << id;
+		foreach(QRectF z, i.zones) foreach(int id, index_suivis.query(z)) remplaces << id;
+	}
+	QMultiHash<QString, int> anciens;
+	foreach(int id, remplaces) anciens.insert(cle(suivis.value(id)), id);
+	
+	foreach(const Constat &c, v.constats) {
+		QMultiHash<QString, int>::iterator it = anciens.find(cle(c));
+		if (it != anciens.end()) {
+			anciens.erase(it);
+			continue;
+		}
+		int id = prochain_id ++;
+		suivis.insert(id, c);
+		suivis_par_sujet.insert(c.sujet, id);
+		index_suivis.insert(id, c.zone);
+		r.ajoutes.insert(id, c);
+	}
+	for (QMultiHash<QString, int>::const_iterator it = anciens.constBegin() ; it != anciens.constEnd() ; ++ it) {
+		int id = it.value();
+		suivis_par_sujet.remove(suivis.value(id).sujet, id);
+		index_suivis.remove(id);
+		suivis.remove(id);
+		r.retires << id;
+	}
+	return(r);
+}
+
+/**
+	@param c Un constat
+	@return Une cle identifiant le constat : deux constats de meme cle sont identiques
+*/
+QString ErcChecker::Worker::cle(const Constat &c) {
+	return(QString("%1|%2|%3|%4|%5|%6|%7").arg(int(c.regle)).arg(qulonglong(c.sujet))
+		.arg(c.zone.x()).arg(c.zone.y()).arg(c.zone.width()).arg(c.zone.height()).arg(c.message));
+}
+
+/**
+	Constructeur
+	@param parent QObject parent
+*/
+ErcChecker::ErcChecker(QObject *parent) : QObject(parent), tout_verifier(false), generation(0) {
+	worker = new Worker();
+	worker -> destinataire = this;
+	worker -> start(QThread::LowPriority);
+	minuterie.setSingleShot(true);
+	minuterie.setInterval(DELAI_ERC);
+	connect(&minuterie, SIGNAL(timeout()), this, SLOT(sendSnapshot()));
+}
+
+/**
+	Destructeur : attend la fin de la verification en cours
+*/
+ErcChecker::~ErcChecker() {
+	delete worker;
+}
+
+/**
+	Change le schema verifie ; il est verifie entierement, puis suivi au fil
+	de ses modifications.
+	@param s Le schema a verifier, ou 0
+*/
+void ErcChecker::setSchema(Schema *s) {
+	if (s == schema_verifie) return;
+	if (schema_verifie) disconnect(schema_verifie, 0, this, 0);
+	schema_verifie = s;
+	// les resultats encore attendus pour l'ancien schema seront ignores
+	++ generation;
+	constats.clear();
+	zones_modifiees.clear();
+	tout_verifier = false;
+	emit(findingsReset());
+	if (s) {
+		connect(s, SIGNAL(contentChanged(const QRectF &)), this, SLOT(invalidate(const QRectF &)));
+		connect(s, SIGNAL(connectivityChanged(Terminal *)), this, SLOT(invalidateNet(Terminal *)));
+		tout_verifier = true;
+		minuterie.start();
+	}
+}
+
+/**
+	Demande la verification d'une zone du schema
+	@param r La zone modifiee, en coordonnees de la scene
+*/
+void ErcChecker::invalidate(const QRectF &r) {
+	if (tout_verifier || r.isNull()) return;
+	zones_modifiees << r;
+	if (zones_modifiees.size() > MAX_ZONES_ERC) {
+		QRectF englobant;
+		foreach(QRectF z, zones_modifiees) englobant |= z;
+		zones_modifiees.clear();
+		zones_modifiees << englobant;
+	}
+	if (!minuterie.isActive()) minuterie.start();
+}
+
+/**
+	Demande la verification de tous les elements du reseau d'une borne, dont la
+	connectivite vient de changer. Appele immediatement par le Schema, tant
+	que la borne existe.
+	@param t Une borne du reseau modifie
+*/
+void ErcChecker::invalidateNet(Terminal *t) {
+	if (tout_verifier || !schema_verifie) return;
+	QSet<QGraphicsItem *> elements;
+	foreach(Terminal *b, schema_verifie -> netTerminals(schema_verifie -> netOf(t))) elements << b -> parentItem();
+	foreach(QGraphicsItem *e, elements) invalidate(e -> sceneBoundingRect());
+}
+
+/**
+	Prend un instantane des zones modifiees et le confie au thread de verification
+*/
+void ErcChecker::sendSnapshot() {
+	if (!schema_verifie || (!tout_verifier && zones_modifiees.isEmpty())) return;
+	// les conducteurs doivent avoir leur trace definitif
+	schema_verifie -> flushConductors();
+	worker -> soumet(capture());
+	zones_modifiees.clear();
+	tout_verifier = false;
+}
+
+/**
+	@return Un instantane des elements et conducteurs des zones modifiees, et
+	des elements proches de ces conducteurs (obstacles)
+*/
+ErcChecker::Instantane ErcChecker::capture() {
+	Instantane i;
+	i.generation = generation;
+	i.zones = zones_modifiees;
+	i.tout = tout_verifier;
+
+	QList<QGraphicsItem *> items;
+	if (tout_verifier) items = schema_verifie -> items();
+	else foreach(QRectF z, zones_modifiees) items += schema_verifie -> items(z);
+
+	QHash<Element *, int> index_elements;
+	QList<Element *> a_verifier;
+	QSet<Conductor *> conducteurs;
+	foreach(QGraphicsItem *qgi, items) {
+		if (Element *e = qgraphicsitem_cast<Element *>(qgi)) a_verifier << e;
+		else if (Conductor *c = qgraphicsitem_cast<Conductor *>(qgi)) conducteurs << c;
+	}
+
+	QRectF voisinage;
+	foreach(Conductor *c, conducteurs) {
+		Instantane::Fil f = {
+			quintptr(c), c -> polyline(),
+			quintptr(qgraphicsitem_cast<Element *>(c -> terminal1 -> parentItem())),
+			quintptr(qgraphicsitem_cast<Element *>(c -> terminal2 -> parentItem()))
+		};
+		i.conducteurs << f;
+		voisinage |= c -> sceneBoundingRect();
+	}
+	// elements verifies, puis obstacles des conducteurs
+	QList<Element *> obstacles;
+	if (!tout_verifier && !voisinage.isNull()) {
+		foreach(QGraphicsItem *qgi, schema_verifie -> items(voisinage)) {
+			if (Element *e = qgraphicsitem_cast<Element *>(qgi)) obstacles << e;
+		}
+	}
+	for (int passe = 0 ; passe < 2 ; ++ passe) {
+		foreach(Element *e, passe ? obstacles : a_verifier) {
+			if (index_elements.contains(e)) {
+				if (!passe) i.elements[index_elements.value(e)].verifie = true;
+				continue;
+			}
+			Instantane::Elmt elmt;
+			elmt.id = quintptr(e);
+			elmt.rect = e -> sceneBoundingRect();
+			elmt.nom = e -> nom();
+			elmt.verifie = !passe;
+			foreach(QGraphicsItem *enfant, e -> childItems()) {
+				Terminal *t = qgraphicsitem_cast<Terminal *>(enfant);
+				if (!t) continue;
+				Instantane::Borne b = { t -> amarrageConducteur(), schema_verifie -> netOf(t), t -> nbConducteurs() > 0 || t -> bundle() };
+				elmt.bornes << b;
+			}
+			index_elements.insert(e, i.elements.size());
+			i.elements << elmt;
+		}
+	}
+	return(i);
+}
+
+/**
+	Integre les differences transmises par le thread de verification, puis
+	signale en une fois les constats retires et ajoutes. Un constat ajoute puis
+	retire entre deux appels n'est pas signale.
+*/
+void ErcChecker::collectResults() {
+	Resultat r;
+	QList<int> retires;
+	QSet<int> ajoutes;
+	while (worker -> resultat(&r)) {
+		if (r.generation != generation) continue;
+		foreach(int id, r.retires) {
+			constats.remove(id);
+			if (!ajoutes.remove(id)) retires << id;
+		}
+		for (QHash<int, Constat>::const_iterator it = r.ajoutes.constBegin() ; it != r.ajoutes.constEnd() ; ++ it) {
+			constats.insert(it.key(), it.value());
+			ajoutes << it.key();
+		}
+	}
+	if (retires.isEmpty() && ajoutes.isEmpty()) return;
+	// les identifiants croissent : les constats ajoutes suivent leur ordre de creation
+	QList<int> liste_ajoutes = ajoutes.toList();
+	std::sort(liste_ajoutes.begin(), liste_ajoutes.end());
+	emit(findingsChanged(retires, liste_ajoutes));
+}
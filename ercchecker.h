@@ -0,0 +1,72 @@
+#ifndef ERCCHECKER_H
+	#define ERCCHECKER_H
+	#include <QtWidgets>
+	class Schema;
+	class Terminal;
+	/**
+		Verificateur de regles electriques (ERC) : bornes non reliees, elements
+		dont deux bornes sont court-circuitees, conducteurs passant sur un element.
+		Les verifications sont faites par un thread dedie, sur un instantane des
+		elements et conducteurs concernes pris dans le thread principal : le
+		thread de verification ne touche jamais aux items de la scene.
+		Apres une modification, seules les zones modifiees et les reseaux dont la
+		connectivite a change sont verifies a nouveau ; les constats des autres
+		zones sont conserves. Le thread de verification compare les nouveaux
+		constats aux precedents et ne transmet que les constats retires et
+		ajoutes, designes par un identifiant : le thread principal n'a jamais a
+		parcourir l'ensemble des constats.
+	*/
+	class ErcChecker : public QObject {
+		Q_OBJECT
+		public:
+		/// regles verifiees
+		enum Regle {
+			BorneLibre,           ///< borne reliee a aucun conducteur
+			CourtCircuit,         ///< deux bornes d'un meme element sur le meme reseau
+			ConducteurSurElement  ///< conducteur passant sur un element
+		};
+		/// constat d'une regle non respectee
+		struct Constat {
+			Regle regle;
+			/// adresse de l'item concerne, a ne comparer qu'a des items existants
+			quintptr sujet;
+			/// zone concernee, en coordonnees de la scene
+			QRectF zone;
+			QString message;
+		};
+		ErcChecker(QObject * = 0);
+		~ErcChecker();
+		void setSchema(Schema *);
+		Schema *schema() const { return(schema_verifie); }
+		/// constats courants, par identifiant
+		const QHash<int, Constat> &findings() const { return(constats); }
+
+		signals:
+		/// tous les constats ont ete oublies (changement de schema)
+		void findingsReset();
+		/// identifiants des constats retires, puis des constats ajoutes
+		void findingsChanged(const QList<int> &, const QList<int> &);
+
+		private slots:
+		void invalidate(const QRectF &);
+		void invalidateNet(Terminal *);
+		void sendSnapshot();
+		void collectResults();
+
+		private:
+		class Worker;
+		struct Instantane;
+		struct Resultat;
+		QPointer<Schema> schema_verifie;
+		Worker *worker;
+		/// zones a verifier lors du prochain instantane
+		QVector<QRectF> zones_modifiees;
+		bool tout_verifier;
+		/// regroupe les modifications rapprochees en un seul instantane
+		QTimer minuterie;
+		QHash<int, Constat> constats;
+		/// incremente a chaque changement de schema
+		int generation;
+		Instantane capture();
+	};
+#endif
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include "ercpanel.h"
+#include "schemaview.h"
+#include "schema.h"
+
+/**
+	Constructeur
+	@param v Le verificateur dont les constats sont listes
+	@param parent QObject parent
+*/
+ErcFindingsModel::ErcFindingsModel(ErcChecker *v, QObject *parent) : QAbstractListModel(parent), verificateur(v) {
+	connect(v, SIGNAL(findingsReset()), this, SLOT(resetFindings()));
+	connect(v, SIGNAL(findingsChanged(const QList<int> &, const QList<int> &)), this, SLOT(updateFindings(const QList<int> &, const QList<int> &)));
+	resetFindings();
+}
+
+/**
+	@param parent Index parent ; la liste n'a qu'un niveau
+	@return Le nombre de constats affiches
+*/
+int ErcFindingsModel::rowCount(const QModelIndex &parent) const {
+	return(parent.isValid() ? 0 : lignes.size());
+}
+
+/**
+	@param index Ligne d'un constat
+	@param role Role demande : texte, couleur, item concerne (Qt::UserRole) ou
+	zone concernee (Qt::UserRole + 1)
+	@return La donnee demandee
+*/
+QVariant ErcFindingsModel::data(const QModelIndex &index, int role) const {
+	if (!index.isValid() || index.row() >= lignes.size()) return(QVariant());
+	const ErcChecker::Constat &c = verificateur -> findings().value(lignes.at(index.row()));
+	switch(role) {
+		case Qt::DisplayRole    : return(c.message);
+		case Qt::ForegroundRole : return(QBrush(c.regle == ErcChecker::BorneLibre ? Qt::darkYellow : Qt::red));
+		case Qt::UserRole       : return(QVariant::fromValue<qulonglong>(c.sujet));
+		case Qt::UserRole + 1   : return(c.zone);
+		default                 : return(QVariant());
+	}
+}
+
+/**
+	Reprend tous les constats du verificateur, apres un changement de schema
+*/
+void ErcFindingsModel::resetFindings() {
+	beginResetModel();
+	lignes.clear();
+	foreach(int id, verificateur -> findings().keys()) lignes << id;
+	std::sort(lignes.begin(), lignes.end());
+	endResetModel();
+}
+
+/**
+	Retire et ajoute les lignes des constats modifies. Les lignes retirees sont
+	retrouvees par recherche dichotomique et retirees par blocs contigus, en
+	partant de la fin ; les constats ajoutes ont des identifiants plus grands
+	que tous les autres et sont ajoutes en fin de liste.
+	@param retires Identifiants des constats retires
+	@param ajoutes Identifiants des constats ajoutes, tries
+*/
+void ErcFindingsModel::updateFindings(const QList<int> &retires, const QList<int> &ajoutes) {
+	QVector<int> rangs;
+	foreach(int id, retires) {
+		QVector<int>::iterator it = std::lower_bound(lignes.begin(), lignes.end(), id);
+		if (it != lignes.end() && *it == id) rangs << int(it - lignes.begin());
+	}
+	std::sort(rangs.begin(), rangs.end());
+	for (int fin = rangs.size() - 1 ; fin >= 0 ; ) {
+		int debut = fin;
+		while (debut > 0 && rangs.at(debut - 1) == rangs.at(debut) - 1) -- debut;
+		beginRemoveRows(QModelIndex(), rangs.at(debut), rangs.at(fin));
+		lignes.remove(rangs.at(debut), fin - debut + 1);
+		endRemoveRows();
+		fin = debut - 1;
+	}
+	if (ajoutes.isEmpty()) return;
+	beginInsertRows(QModelIndex(), lignes.size(), lignes.size() + ajoutes.size() - 1);
+	foreach(int id, ajoutes) lignes << id;
+	endInsertRows();
+}
+
+/**
+	Constructeur
+	@param parent Le QWidget parent du panel
+*/
+ErcPanel::ErcPanel(QWidget *parent) : QListView(parent) {
+	setSelectionMode(QAbstractItemView::SingleSelection);
+	setUniformItemSizes(true);
+	setToolTip(tr("Double-cliquez sur un constat pour afficher l'item concerne"));
+	modele = new ErcFindingsModel(&verificateur, this);
+	setModel(modele);
+	connect(this, SIGNAL(activated(const QModelIndex &)), this, SLOT(showFinding(const QModelIndex &)));
+}
+
+/**
+	Change la vue dont le schema est verifie
+	@param sv La vue courante, ou 0 s'il n'y en a aucune
+*/
+void ErcPanel::setSchemaView(SchemaView *sv) {
+	vue = sv;
+	verificateur.setSchema(sv ? sv -> scene : 0);
+}
+
+/**
+	Selectionne l'item concerne par un constat et centre la vue sur lui. L'item
+	est retrouve parmi les items presents dans la zone du constat : un item
+	supprime entre-temps n'est donc jamais utilise.
+	@param index La ligne de la liste correspondant au constat
+*/
+void ErcPanel::showFinding(const QModelIndex &index) {
+	if (!vue || vue -> scene != verificateur.schema()) return;
+	quintptr sujet = index.data(Qt::UserRole).value<qulonglong>();
+	QRectF zone = index.data(Qt::UserRole + 1).toRectF();
+	vue -> scene -> clearSelection();
+	foreach(QGraphicsItem *qgi, vue -> scene -> items(zone)) {
+		if (quintptr(qgi) == sujet) qgi -> setSelected(true);
+	}
+	vue -> centerOn(zone.center());
+}
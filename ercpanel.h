@@ -0,0 +1,49 @@
+#ifndef ERCPANEL_H
+	#define ERCPANEL_H
+	#include <QtWidgets>
+	#include "ercchecker.h"
+	class SchemaView;
+	/**
+		Modele de la liste des constats d'un verificateur de regles electriques.
+		Seules les lignes des constats retires ou ajoutes sont mises a jour : la
+		liste n'est jamais reconstruite apres une modification du schema.
+		Les lignes suivent l'ordre des identifiants des constats, qui est leur
+		ordre de creation.
+	*/
+	class ErcFindingsModel : public QAbstractListModel {
+		Q_OBJECT
+		public:
+		ErcFindingsModel(ErcChecker *, QObject * = 0);
+		int rowCount(const QModelIndex & = QModelIndex()) const;
+		QVariant data(const QModelIndex &, int = Qt::DisplayRole) const;
+		
+		public slots:
+		void resetFindings();
+		void updateFindings(const QList<int> &, const QList<int> &);
+		
+		private:
+		ErcChecker *verificateur;
+		/// identifiants des constats affiches, tries
+		QVector<int> lignes;
+	};
+	
+	/**
+		Panel listant les constats du verificateur de regles electriques pour le
+		schema courant. Un double-clic sur un constat selectionne l'item
+		concerne et centre la vue sur lui.
+	*/
+	class ErcPanel : public QListView {
+		Q_OBJECT
+		public:
+		ErcPanel(QWidget * = 0);
+		void setSchemaView(SchemaView *);
+		
+		private slots:
+		void showFinding(const QModelIndex &);
+		
+		private:
+		ErcChecker verificateur;
+		ErcFindingsModel *modele;
+		QPointer<SchemaView> vue;
+	};
+#endif
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include "groupmove.h"
+#include "schema.h"
+#include "element.h"
+#include "conductor.h"
+#include "conductorbundle.h"
+
+namespace {
+	/**
+		Support invisible des items d'un grand deplacement groupe. Il declare
+		contenir ses enfants : la scene ne les indexe pas un par un, elle les
+		trouve en passant par lui.
+	*/
+	class SupportDeplacement : public QGraphicsItem {
+		public:
+		SupportDeplacement(const QRectF &r) : zone(r) {
+			setFlag(QGraphicsItem::ItemHasNoContents);
+			setFlag(QGraphicsItem::ItemContainsChildrenInShape);
+		}
+		QRectF boundingRect() const { return(zone); }
+		void paint(QPainter *, const QStyleOptionGraphicsItem *, QWidget *) {}
+		private:
+		QRectF zone;
+	};
+}
+
+/**
+	Commence un deplacement groupe
+	@param s Le schema contenant les items
+	@param items Les items a deplacer, typiquement la selection du schema ;
+	les conducteurs, qui suivent leurs bornes, et les items dont le parent est
+	deplace sont ignores
+*/
+GroupMove::GroupMove(Schema *s, const QList<QGraphicsItem *> &items) :
+	schema(s),
+	support(0),
+	termine(false)
+{
+	QSet<Element *> deplaces;
+	foreach(QGraphicsItem *qgi, items) {
+		if (qgi -> parentItem() && qgi -> parentItem() -> isSelected()) continue;
+		if (qgi -> type() == Conductor::Type || qgi -> type() == ConductorBundle::Type) continue;
+		emprise |= qgi -> sceneBoundingRect() | qgi -> mapRectToScene(qgi -> childrenBoundingRect());
+		if (Element *e = qgraphicsitem_cast<Element *>(qgi)) {
+			elements << e;
+			depart_elements << e -> pos();
+			deplaces << e;
+			notifiants << bool(e -> flags() & QGraphicsItem::ItemSendsGeometryChanges);
+			// les changements de position ne sont notifies qu'a la fin du deplacement
+			e -> setFlag(QGraphicsItem::ItemSendsGeometryChanges, false);
+		} else {
+			autres << qgi;
+			depart_autres << qgi -> pos();
+		}
+	}
+	
+	QSet<Conductor *> conducteurs;
+	QSet<ConductorBundle *> liste_faisceaux;
+	foreach(Element *e, elements) {
+		foreach(QGraphicsItem *qgi, e -> childItems()) {
+			Terminal *t = qgraphicsitem_cast<Terminal *>(qgi);
+			if (!t) continue;
+			foreach(Conductor *c, t -> conducteurs()) conducteurs << c;
+			if (t -> bundle()) liste_faisceaux << t -> bundle();
+		}
+	}
+	foreach(Conductor *c, conducteurs) {
+		Element *e1 = qgraphicsitem_cast<Element *>(c -> terminal1 -> parentItem());
+		Element *e2 = qgraphicsitem_cast<Element *>(c -> terminal2 -> parentItem());
+		if (deplaces.contains(e1) && deplaces.contains(e2)) internes << c;
+		else externes << c;
+	}
+	foreach(ConductorBundle *f, liste_faisceaux) faisceaux << f;
+	
+	// les items d'un grand deplacement sont retires de l'index de la scene au
+	// profit de leur support, place a l'origine : leurs positions sont inchangees
+	if (elements.size() >= SEUIL_INDEX_DEPLACEMENT) {
+		// seuls les items de premier niveau changent de parent
+		QSet<QGraphicsItem *> a_porter;
+		foreach(Element *e, elements) if (!e -> parentItem()) a_porter << e;
+		foreach(QGraphicsItem *qgi, autres) if (!qgi -> parentItem()) a_porter << qgi;
+		// l'empilement d'origine est note pour etre retabli au relachement : le
+		// retour au premier niveau placerait les items deplaces au-dessus des autres
+		QList<QGraphicsItem *> ordre = schema -> items(Qt::AscendingOrder);
+		QGraphicsItem *suivant = 0;
+		for (int k = ordre.size() - 1 ; k >= 0 ; -- k) {
+			QGraphicsItem *qgi = ordre.at(k);
+			if (qgi -> parentItem()) continue;
+			if (!a_porter.contains(qgi)) {
+				suivant = qgi;
+				continue;
+			}
+			portes << qgi;
+			// stackBefore() n'agit qu'entre items de meme z
+			if (suivant && suivant -> zValue() == qgi -> zValue()) ancres.insert(qgi, suivant);
+		}
+		std::reverse(portes.begin(), portes.end());
+		support = new SupportDeplacement(emprise);
+		schema -> addItem(support);
+		foreach(QGraphicsItem *qgi, portes) qgi -> setParentItem(support);
+	}
+}
+
+/**
+	Destructeur : le deplacement est termine s'il ne l'etait pas
+*/
+GroupMove::~GroupMove() {
+	finish();
+}
+
+/**
+	Deplace tous les items du groupe
+	@param d Decalage depuis le debut du deplacement ; il est arrondi a la grille
+*/
+void GroupMove::moveBy(const QPointF &d) {
+	if (termine) return;
+	QPointF nouveau(qRound(d.x() / GRILLE_X) * GRILLE_X, qRound(d.y() / GRILLE_Y) * GRILLE_Y);
+	if (nouveau == decalage) return;
+	QPointF pas = nouveau - decalage;
+	QRectF ancienne_zone = emprise.translated(decalage);
+	decalage = nouveau;
+	
+	// les positions de depart sont deja sur la grille : pas de nouvel arrondi
+	if (support) support -> setPos(decalage);
+	for (int i = 0 ; i < elements.size() ; ++ i) {
+		if (!support || elements.at(i) -> parentItem() != support) elements.at(i) -> QGraphicsItem::setPos(depart_elements.at(i) + decalage);
+	}
+	for (int i = 0 ; i < autres.size() ; ++ i) {
+		if (!support || autres.at(i) -> parentItem() != support) autres.at(i) -> setPos(depart_autres.at(i) + decalage);
+	}
+	foreach(Conductor *c, internes) c -> translatePath(pas);
+	foreach(Conductor *c, externes) c -> markDirty();
+	foreach(ConductorBundle *f, faisceaux) f -> markDirty();
+	schema -> invalidateSelection(ancienne_zone | emprise.translated(decalage));
+}
+
+/**
+	Termine le deplacement : les items portes par le support le quittent et
+	retrouvent leur place dans l'index de la scene, les elements notifient le
+	Schema de leur nouvelle position et les conducteurs qui traversent
+	desormais un element sont recalcules.
+*/
+void GroupMove::finish() {
+	if (termine) return;
+	termine = true;
+	if (support) {
+		// les items reviennent au premier niveau dans leur ordre d'origine, a
+		// leur position de depart : la position finale est appliquee ensuite
+		foreach(QGraphicsItem *qgi, portes) qgi -> setParentItem(0);
+		for (int i = 0 ; i < elements.size() ; ++ i) elements.at(i) -> QGraphicsItem::setPos(depart_elements.at(i) + decalage);
+		for (int i = 0 ; i < autres.size() ; ++ i) autres.at(i) -> setPos(depart_autres.at(i) + decalage);
+		// chaque item est replace sous l'item qui le couvrait
+		foreach(QGraphicsItem *qgi, portes) {
+			if (QGraphicsItem *ancre = ancres.value(qgi)) qgi -> stackBefore(ancre);
+		}
+		delete support;
+		support = 0;
+	}
+	for (int i = 0 ; i < elements.size() ; ++ i) elements.at(i) -> setFlag(QGraphicsItem::ItemSendsGeometryChanges, notifiants.at(i));
+	if (decalage.isNull()) return;
+	foreach(Element *e, elements) schema -> elementGeometryChanged(e);
+	// les trajets translates pendant le deplacement ont ete verifies contre l'ancien index des elements
+	if (schema -> autoRouting()) {
+		foreach(Conductor *c, internes) if (!schema -> pathIsClear(c -> polyline(), c)) c -> markDirty();
+	}
+	foreach(Conductor *c, externes) c -> markDirty();
+}
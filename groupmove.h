@@ -0,0 +1,59 @@
+#ifndef GROUPMOVE_H
+	#define GROUPMOVE_H
+	#include <QtWidgets>
+	class Schema;
+	class Element;
+	class Conductor;
+	class ConductorBundle;
+	/// nombre d'elements deplaces a partir duquel ils sont portes par un support commun
+	#define SEUIL_INDEX_DEPLACEMENT 200
+	/**
+		Deplacement groupe d'items selectionnes, du clic au relachement de la
+		souris. La selection est photographiee une seule fois au debut ; a chaque
+		mouvement, tous les items sont decales du meme vecteur, les conducteurs
+		dont les deux bornes sont deplacees sont translates et ceux qui relient
+		le groupe au reste du schema sont recalcules, une fois chacun.
+		Pendant le deplacement, les elements ne notifient pas le Schema de leurs
+		changements de position ; l'index des elements du Schema n'est mis a jour
+		qu'une fois, a la fin du deplacement. Pour les grandes selections, les
+		items deplaces sont rattaches a un support commun qui contient ses
+		enfants (ItemContainsChildrenInShape) : l'index de la scene ne suit que
+		le support, et seuls les items deplaces y sont retires puis remis, le
+		reste de la scene restant indexe.
+	*/
+	class GroupMove {
+		public:
+		GroupMove(Schema *, const QList<QGraphicsItem *> &);
+		~GroupMove();
+		void moveBy(const QPointF &);
+		void finish();
+		/// decalage courant des items depuis le debut du deplacement
+		QPointF offset() const { return(decalage); }
+		int size() const { return(elements.size() + autres.size()); }
+		
+		private:
+		Schema *schema;
+		QVector<Element *> elements;
+		QVector<QPointF> depart_elements;
+		/// elements qui notifiaient leurs changements de position avant le deplacement
+		QVector<bool> notifiants;
+		/// items deplaces qui ne sont pas des elements
+		QVector<QGraphicsItem *> autres;
+		QVector<QPointF> depart_autres;
+		/// conducteurs dont les deux bornes sont deplacees
+		QVector<Conductor *> internes;
+		/// conducteurs et faisceaux reliant le groupe au reste du schema
+		QVector<Conductor *> externes;
+		QVector<ConductorBundle *> faisceaux;
+		/// zone occupee par les items au debut du deplacement
+		QRectF emprise;
+		QPointF decalage;
+		/// support des items deplaces pour les grandes selections, 0 sinon
+		QGraphicsItem *support;
+		/// items rattaches au support, du plus bas au plus haut dans l'empilement d'origine
+		QVector<QGraphicsItem *> portes;
+		/// pour chaque item rattache, le premier item non deplace qui le couvrait
+		QHash<QGraphicsItem *, QGraphicsItem *> ancres;
+		bool termine;
+	};
+#endif
@@ -0,0 +1,163 @@
+#include "netconnectivity.h"
+
+/**
+	Enregistre une liaison entre deux bornes ; leurs reseaux sont fusionnes
+	@param a Premiere borne
+	@param b Seconde borne
+*/
+void NetConnectivity::connect(Terminal *a, Terminal *b) {
+	int ia = numero(a);
+	int ib = numero(b);
+	voisins[ia] << ib;
+	voisins[ib] << ia;
+	unite(racine(ia), racine(ib));
+}
+
+/**
+	Retire une liaison entre deux bornes. Si elles ne sont plus reliees
+	directement, leur reseau est reconstruit et peut se scinder.
+	@param a Premiere borne
+	@param b Seconde borne
+*/
+void NetConnectivity::disconnect(Terminal *a, Terminal *b) {
+	if (!numeros.contains(a) || !numeros.contains(b)) return;
+	int ia = numeros.value(a);
+	int ib = numeros.value(b);
+	int index_a = voisins.at(ia).indexOf(ib);
+	int index_b = voisins.at(ib).indexOf(ia);
+	if (index_a == -1 || index_b == -1) return;
+	voisins[ia].remove(index_a);
+	voisins[ib].remove(index_b);
+	// une autre liaison relie encore les deux bornes : rien ne change
+	if (voisins.at(ia).contains(ib)) return;
+	reconstruit(racine(ia));
+}
+
+/**
+	Oublie une borne retiree du schema, ainsi que ses liaisons
+	@param t La borne retiree
+*/
+void NetConnectivity::removeTerminal(Terminal *t) {
+	if (!numeros.contains(t)) return;
+	int i = numeros.value(t);
+	while (!voisins.at(i).isEmpty()) disconnect(t, bornes.at(voisins.at(i).first()));
+	// la borne est desormais seule dans son reseau
+	membres.remove(i);
+	numeros.remove(t);
+	bornes[i] = 0;
+	parents[i] = i;
+	libres << i;
+}
+
+/**
+	Oublie toutes les bornes et toutes les liaisons
+*/
+void NetConnectivity::clear() {
+	numeros.clear();
+	bornes.clear();
+	parents.clear();
+	voisins.clear();
+	membres.clear();
+	libres.clear();
+}
+
+/**
+	@param t Une borne
+	@return Le numero du reseau de la borne ; une borne sans liaison forme un
+	reseau a elle seule
+*/
+int NetConnectivity::net(Terminal *t) {
+	return(racine(numero(t)));
+}
+
+/**
+	@param a Premiere borne
+	@param b Seconde borne
+	@return true si les deux bornes appartiennent au meme reseau
+*/
+bool NetConnectivity::connected(Terminal *a, Terminal *b) {
+	return(net(a) == net(b));
+}
+
+/**
+	@param n Un numero de reseau, tel que retourne par net()
+	@return Les bornes du reseau
+*/
+QList<Terminal *> NetConnectivity::terminals(int n) const {
+	QList<Terminal *> resultat;
+	foreach(int i, membres.value(n)) resultat << bornes.at(i);
+	return(resultat);
+}
+
+/**
+	@param t Une borne
+	@return Le numero interne de la borne, qui est enregistree si besoin
+*/
+int NetConnectivity::numero(Terminal *t) {
+	QHash<Terminal *, int>::const_iterator it = numeros.constFind(t);
+	if (it != numeros.constEnd()) return(it.value());
+	int i;
+	if (libres.isEmpty()) {
+		i = bornes.size();
+		bornes << t;
+		parents << i;
+		voisins << QVector<int>();
+	} else {
+		i = libres.last();
+		libres.removeLast();
+		bornes[i] = t;
+		parents[i] = i;
+		voisins[i].clear();
+	}
+	numeros.insert(t, i);
+	membres.insert(i, QVector<int>() << i);
+	return(i);
+}
+
+/**
+	@param i Un numero interne de borne
+	@return La racine de son reseau ; les chemins parcourus sont raccourcis
+*/
+int NetConnectivity::racine(int i) {
+	while (parents.at(i) != i) {
+		parents[i] = parents.at(parents.at(i));
+		i = parents.at(i);
+	}
+	return(i);
+}
+
+/**
+	Fusionne deux reseaux : le plus petit est rattache au plus grand
+	@param a Racine du premier reseau
+	@param b Racine du second reseau
+*/
+void NetConnectivity::unite(int a, int b) {
+	if (a == b) return;
+	if (membres.value(a).size() < membres.value(b).size()) qSwap(a, b);
+	parents[b] = a;
+	membres[a] += membres.take(b);
+}
+
+/**
+	Reconstruit un reseau a partir des liaisons de ses membres, par un parcours
+	en largeur ; chaque partie connexe devient un reseau.
+	@param r Racine du reseau a reconstruire
+*/
+void NetConnectivity::reconstruit(int r) {
+	QVector<int> anciens = membres.take(r);
+	foreach(int i, anciens) parents[i] = -1;
+	foreach(int i, anciens) {
+		if (parents.at(i) != -1) continue;
+		QVector<int> partie;
+		parents[i] = i;
+		partie << i;
+		for (int k = 0 ; k < partie.size() ; ++ k) {
+			foreach(int j, voisins.at(partie.at(k))) {
+				if (parents.at(j) != -1) continue;
+				parents[j] = i;
+				partie << j;
+			}
+		}
+		membres.insert(i, partie);
+	}
+}
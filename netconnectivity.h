@@ -0,0 +1,48 @@
+#ifndef NETCONNECTIVITY_H
+	#define NETCONNECTIVITY_H
+	#include <QtCore>
+	class Terminal;
+	/**
+		Connectivite electrique des bornes d'un schema : deux bornes reliees,
+		directement ou par l'intermediaire d'autres bornes, appartiennent au meme
+		reseau (net).
+		Les reseaux sont maintenus par une structure union-find (union par taille,
+		compression de chemin) : l'ajout d'une liaison et la recherche du reseau
+		d'une borne sont en O(alpha(n)). Le retrait d'une liaison ne reconstruit
+		que le reseau concerne, a partir des liaisons restantes.
+		Chaque reseau connait la liste de ses bornes : aucun parcours de la scene
+		n'est necessaire pour les retrouver.
+		Les numeros de reseaux ne sont stables qu'entre deux modifications.
+	*/
+	class NetConnectivity {
+		public:
+		void connect(Terminal *, Terminal *);
+		void disconnect(Terminal *, Terminal *);
+		void removeTerminal(Terminal *);
+		void clear();
+		int net(Terminal *);
+		bool connected(Terminal *, Terminal *);
+		QList<Terminal *> terminals(int) const;
+		QList<int> nets() const { return(membres.keys()); }
+		int netCount() const { return(membres.size()); }
+		int terminalCount() const { return(numeros.size()); }
+
+		private:
+		/// numero interne de chaque borne connue
+		QHash<Terminal *, int> numeros;
+		/// borne correspondant a chaque numero, 0 pour un numero libere
+		QVector<Terminal *> bornes;
+		/// parent de chaque numero dans la foret union-find
+		QVector<int> parents;
+		/// liaisons de chaque numero ; une liaison doublee apparait deux fois
+		QVector<QVector<int> > voisins;
+		/// membres de chaque reseau, indexes par la racine du reseau
+		QHash<int, QVector<int> > membres;
+		/// numeros liberes, reutilises par les bornes suivantes
+		QVector<int> libres;
+		int numero(Terminal *);
+		int racine(int);
+		void unite(int, int);
+		void reconstruit(int);
+	};
+#endif
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include "netlistexporter.h"
+#include "schema.h"
+#include "element.h"
+#include "conductor.h"
+#include "conductorbundle.h"
+
+/**
+	Constructeur
+	@param s Schema dont la netlist doit etre exportee
+*/
+NetlistExporter::NetlistExporter(Schema *s) : schema(s), nb_reseaux(0) {
+}
+
+/**
+	@param nom Nom d'un format : "spice" ou "csv", sans tenir compte de la casse
+	@param format Recoit le format correspondant
+	@return true si le nom designe un format connu
+*/
+bool NetlistExporter::formatFromName(const QString &nom, Format *format) {
+	QString n = nom.toLower();
+	if (n == "spice" || n == "cir" || n == "net") *format = Spice;
+	else if (n == "csv") *format = Csv;
+	else return(false);
+	return(true);
+}
+
+/**
+	Ecrit la netlist dans un fichier
+	@param nom_fichier Chemin du fichier a ecrire
+	@param format Format de la netlist
+	@return true si l'ecriture a reussi, false sinon
+*/
+bool NetlistExporter::write(const QString &nom_fichier, Format format) {
+	QFile fichier(nom_fichier);
+	if (!fichier.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) return(false);
+	return(write(&fichier, format));
+}
+
+/**
+	Ecrit la netlist sur un peripherique deja ouvert. Les lignes sont ecrites
+	au fur et a mesure du parcours des elements.
+	@param sortie Peripherique sur lequel ecrire
+	@param format Format de la netlist
+	@return true si l'ecriture a reussi, false sinon
+*/
+bool NetlistExporter::write(QIODevice *sortie, Format format) {
+	numerote();
+	QTextStream flux(sortie);
+	if (format == Spice) flux << "* netlist QElectroTech" << endl;
+	else flux << "instance;type;borne;reseau" << endl;
+	for (int i = 0 ; i < elements.size() ; ++ i) {
+		Element *elmt = elements.at(i);
+		QString instance = QString("X%1").arg(i + 1);
+		QString nom_type = type(elmt);
+		QList<Terminal *> liste_bornes = bornes(elmt);
+		if (format == Spice) {
+			flux << instance;
+			foreach(Terminal *t, liste_bornes) flux << " N" << reseaux.value(t);
+			flux << " " << nom_type << "\n";
+		} else {
+			for (int j = 0 ; j < liste_bornes.size() ; ++ j) {
+				flux << instance << ";" << nom_type << ";" << (j + 1) << ";N" << reseaux.value(liste_bornes.at(j)) << "\n";
+			}
+		}
+		if (flux.status() != QTextStream::Ok) return(false);
+	}
+	if (format == Spice) flux << ".end" << endl;
+	flux.flush();
+	return(flux.status() == QTextStream::Ok);
+}
+
+/**
+	Numerote les reseaux du schema par un parcours en largeur de borne en
+	borne. Chaque borne et chaque liaison n'est visitee qu'une fois : le cout
+	est lineaire. Une borne libre forme un reseau a elle seule.
+	Les instances sont numerotees selon la position des elements, et non selon
+	l'ordre d'empilement de la scene, qui change lorsqu'on manipule le schema.
+*/
+void NetlistExporter::numerote() {
+	elements.clear();
+	reseaux.clear();
+	nb_reseaux = 0;
+	foreach(QGraphicsItem *qgi, schema -> items()) {
+		if (Element *elmt = qgraphicsitem_cast<Element *>(qgi)) elements << elmt;
+	}
+	// les items de la scene sont du plus haut au plus bas : a position et type
+	// egaux, les instances suivent l'ordre d'ajout
+	std::reverse(elements.begin(), elements.end());
+	std::stable_sort(elements.begin(), elements.end(), precede);
+
+	// borne en vis-a-vis de chaque borne de faisceau, calculee une fois par faisceau
+	QHash<Terminal *, Terminal *> vis_a_vis;
+	QSet<ConductorBundle *> faisceaux;
+	QVector<Terminal *> file;
+	foreach(Element *elmt, elements) {
+		foreach(Terminal *depart, bornes(elmt)) {
+			if (reseaux.contains(depart)) continue;
+			int reseau = ++ nb_reseaux;
+			file.clear();
+			file << depart;
+			reseaux.insert(depart, reseau);
+			for (int k = 0 ; k < file.size() ; ++ k) {
+				Terminal *t = file.at(k);
+				QList<Terminal *> voisines;
+				foreach(Conductor *c, t -> conducteurs()) voisines << (c -> terminal1 == t ? c -> terminal2 : c -> terminal1);
+				if (ConductorBundle *f = t -> bundle()) {
+					if (!faisceaux.contains(f)) {
+						faisceaux.insert(f);
+						for (int i = 0 ; i < f -> size() ; ++ i) {
+							vis_a_vis.insert(f -> terminals1().at(i), f -> terminals2().at(i));
+							vis_a_vis.insert(f -> terminals2().at(i), f -> terminals1().at(i));
+						}
+					}
+					voisines << vis_a_vis.value(t);
+				}
+				foreach(Terminal *v, voisines) {
+					if (reseaux.contains(v)) continue;
+					reseaux.insert(v, reseau);
+					file << v;
+				}
+			}
+		}
+	}
+}
+
+/**
+	@param elmt Un element
+	@return Les bornes de l'element, dans l'ordre de sa definition
+*/
+QList<Terminal *> NetlistExporter::bornes(Element *elmt) {
+	QList<Terminal *> resultat;
+	foreach(QGraphicsItem *qgi, elmt -> childItems()) {
+		if (Terminal *t = qgraphicsitem_cast<Terminal *>(qgi)) resultat << t;
+	}
+	return(resultat);
+}
+
+/**
+	Ordre des instances : de haut en bas, de gauche a droite, puis par type
+	@param e1 Un element
+	@param e2 Un autre element
+	@return true si e1 doit etre numerote avant e2
+*/
+bool NetlistExporter::precede(Element *e1, Element *e2) {
+	QPointF p1 = e1 -> pos(), p2 = e2 -> pos();
+	if (p1.y() != p2.y()) return(p1.y() < p2.y());
+	if (p1.x() != p2.x()) return(p1.x() < p2.x());
+	return(e1 -> typeId() < e2 -> typeId());
+}
+
+/**
+	@param elmt Un element
+	@return Le type de l'element, utilisable comme identifiant dans une netlist :
+	nom du fichier de definition pour un element personnalise
+*/
+QString NetlistExporter::type(Element *elmt) {
+	QString nom = QFileInfo(elmt -> typeId()).completeBaseName();
+	if (nom.isEmpty()) nom = elmt -> typeId();
+	nom.replace(QRegExp("[^A-Za-z0-9_]"), "_");
+	return(nom);
+}
@@ -0,0 +1,43 @@
+#ifndef NETLISTEXPORTER_H
+	#define NETLISTEXPORTER_H
+	#include <QtCore>
+	class Schema;
+	class Element;
+	class Terminal;
+	/**
+		Export de la netlist d'un schema : pour chaque borne de chaque element
+		(type, instance, numero de borne), le reseau electrique auquel elle
+		appartient. Les reseaux sont obtenus en suivant les conducteurs et les
+		faisceaux de borne en borne.
+		L'export se fait en deux passes lineaires, apres un tri des elements par
+		position : numerotation des reseaux, puis ecriture ligne par ligne dans
+		le fichier. Seule la table des numeros de
+		reseaux est gardee en memoire, jamais le texte produit.
+	*/
+	class NetlistExporter {
+		public:
+		/// format de la netlist
+		enum Format {
+			Spice, ///< une ligne par element : instance, reseaux de ses bornes, type
+			Csv    ///< une ligne par borne : instance, type, borne, reseau
+		};
+		NetlistExporter(Schema *);
+		bool write(QIODevice *, Format);
+		bool write(const QString &, Format);
+		int netCount() const { return(nb_reseaux); }
+		int terminalCount() const { return(reseaux.size()); }
+		static bool formatFromName(const QString &, Format *);
+
+		private:
+		Schema *schema;
+		/// elements du schema, dans l'ordre des instances : de haut en bas puis de gauche a droite
+		QList<Element *> elements;
+		/// numero de reseau de chaque borne
+		QHash<Terminal *, int> reseaux;
+		int nb_reseaux;
+		void numerote();
+		static QList<Terminal *> bornes(Element *);
+		static bool precede(Element *, Element *);
+		static QString type(Element *);
+	};
+#endif
@@ -0,0 +1,143 @@
+#include "paintstats.h"
+
+/// number of frames kept for the rolling histogram
+#define NB_FRAMES_RECENTES 120
+/// maximal number of frames kept for the CSV export
+#define NB_FRAMES_CAPTUREES 100000
+/// number of classes of the histogram
+#define NB_CLASSES 8
+
+int PaintStats::active = 0;
+PaintStats::Frame PaintStats::current = { 0, 0, 0, 0, 0, 0, 0, 0.0 };
+
+/**
+	Closes the current frame : the counters accumulated since the previous
+	frame are returned and reset.
+	@param duree_us Time spent painting the frame, in microseconds
+	@param aire Area of the exposed region, in pixels
+	@return The counters of the frame
+*/
+PaintStats::Frame PaintStats::endFrame(qint64 duree_us, qreal aire) {
+	Frame f = current;
+	f.duree_us = duree_us;
+	f.aire     = aire;
+	Frame vide = { 0, 0, 0, 0, 0, 0, 0, 0.0 };
+	current = vide;
+	return(f);
+}
+
+/**
+	Constructeur
+	@param parent Le QWidget parent de la surcouche (le viewport de la vue)
+*/
+PaintStatsOverlay::PaintStatsOverlay(QWidget *parent) : QWidget(parent) {
+	// la surcouche est opaque : la redessiner n'entraine pas de rendu de la vue
+	setAttribute(Qt::WA_OpaquePaintEvent);
+	setAttribute(Qt::WA_TransparentForMouseEvents);
+	setFixedSize(230, 164);
+	move(8, 8);
+	prochaine = 0;
+}
+
+/**
+	Ajoute une frame aux statistiques
+	@param f Les compteurs de la frame
+*/
+void PaintStatsOverlay::addFrame(const PaintStats::Frame &f) {
+	if (recentes.size() < NB_FRAMES_RECENTES) recentes.append(f);
+	else recentes[prochaine] = f;
+	prochaine = (prochaine + 1) % NB_FRAMES_RECENTES;
+	if (capturees.size() < NB_FRAMES_CAPTUREES) capturees.append(f);
+	update();
+}
+
+/**
+	Oublie toutes les frames capturees
+*/
+void PaintStatsOverlay::clear() {
+	recentes.clear();
+	capturees.clear();
+	prochaine = 0;
+	update();
+}
+
+/**
+	Exporte les frames capturees au format CSV
+	@param nom_fichier Chemin du fichier a ecrire
+	@return true si l'export a reussi, false sinon
+*/
+bool PaintStatsOverlay::exportCsv(const QString &nom_fichier) const {
+	QFile file(nom_fichier);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return(false);
+	QTextStream out(&file);
+	out << "frame,paint_us,elements,terminals,conductors,calculate_conductor,recompute_requests,translated_paths,exposed_area\n";
+	for (int i = 0 ; i < capturees.size() ; ++ i) {
+		const PaintStats::Frame &f = capturees.at(i);
+		out << i << "," << f.duree_us << "," << f.elements << "," << f.terminals << ",";
+		out << f.conductors << "," << f.calculs << "," << f.demandes << "," << f.translations << "," << qRound64(f.aire) << "\n";
+	}
+	file.close();
+	return(true);
+}
+
+/**
+	@param duree_us Duree d'une frame en microsecondes
+	@return La classe de l'histogramme correspondante : < 1 ms, < 2 ms, < 4 ms ... >= 64 ms
+*/
+int PaintStatsOverlay::classeHistogramme(qint64 duree_us) {
+	int classe = 0;
+	qint64 limite = 1000;
+	while (classe < NB_CLASSES - 1 && duree_us >= limite) {
+		++ classe;
+		limite *= 2;
+	}
+	return(classe);
+}
+
+/**
+	Dessine les compteurs de la derniere frame et l'histogramme des temps de rendu
+*/
+void PaintStatsOverlay::paintEvent(QPaintEvent *) {
+	QPainter p(this);
+	p.fillRect(rect(), QColor(32, 32, 32));
+	p.setPen(Qt::white);
+
+	if (recentes.isEmpty()) {
+		p.drawText(rect().adjusted(6, 4, -6, -4), Qt::AlignLeft | Qt::AlignTop, tr("En attente d'une frame..."));
+		return;
+	}
+
+	const PaintStats::Frame &f = recentes.at((prochaine + recentes.size() - 1) % recentes.size());
+	qint64 total = 0;
+	int classes[NB_CLASSES] = { 0 };
+	foreach(const PaintStats::Frame &r, recentes) {
+		total += r.duree_us;
+		++ classes[classeHistogramme(r.duree_us)];
+	}
+
+	QString texte = QString(
+		"frame : %1 ms (moy. %2 ms)\n"
+		"elements : %3  bornes : %4\n"
+		"conducteurs : %5  translations : %8\n"
+		"calculs : %6  demandes : %7\n"
+		"zone exposee : %9 px"
+	).arg(f.duree_us / 1000.0, 0, 'f', 2)
+	 .arg(total / 1000.0 / recentes.size(), 0, 'f', 2)
+	 .arg(f.elements).arg(f.terminals)
+	 .arg(f.conductors).arg(f.calculs)
+	 .arg(f.demandes).arg(f.translations)
+	 .arg(qRound64(f.aire));
+	p.drawText(QRect(6, 4, width() - 12, 78), Qt::AlignLeft | Qt::AlignTop, texte);
+
+	// histogramme des temps de rendu des dernieres frames
+	int max = 1;
+	for (int i = 0 ; i < NB_CLASSES ; ++ i) if (classes[i] > max) max = classes[i];
+	QRect zone(6, 88, width() - 12, height() - 106);
+	int largeur = zone.width() / NB_CLASSES;
+	for (int i = 0 ; i < NB_CLASSES ; ++ i) {
+		int h = classes[i] * zone.height() / max;
+		p.fillRect(zone.x() + i * largeur + 1, zone.bottom() - h, largeur - 2, h, i < 4 ? QColor(80, 200, 80) : QColor(220, 80, 60));
+	}
+	p.drawText(QRect(6, height() - 16, width() - 12, 14), Qt::AlignLeft, "<1ms");
+	p.drawText(QRect(6, height() - 16, width() - 12, 14), Qt::AlignRight, ">64ms");
+}
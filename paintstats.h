@@ -0,0 +1,59 @@
+#ifndef PAINTSTATS_H
+	#define PAINTSTATS_H
+	#include <QtWidgets>
+	/**
+		Rendering counters displayed by the statistics overlay of SchemaView.
+		The counters are only incremented while at least one view shows the
+		overlay ; otherwise each PAINTSTATS_COUNT boils down to a single test.
+		The counters are only meant to be used from the GUI thread.
+	*/
+	class PaintStats {
+		public:
+		/// counters of a single frame
+		struct Frame {
+			qint64 duree_us;
+			int elements;
+			int terminals;
+			int conductors;
+			int calculs;
+			int demandes;
+			int translations;
+			qreal aire;
+		};
+		/// number of views currently displaying the overlay
+		static int active;
+		/// counters accumulated since the end of the previous frame
+		static Frame current;
+		static Frame endFrame(qint64, qreal);
+	};
+
+	#ifdef QET_NO_PAINTSTATS
+		#define PAINTSTATS_COUNT(champ) do {} while (0)
+	#else
+		#define PAINTSTATS_COUNT(champ) do { if (PaintStats::active) ++ PaintStats::current.champ; } while (0)
+	#endif
+
+	/**
+		Overlay widget drawn on top of the viewport of a SchemaView : it shows
+		the counters of the last frame and a rolling histogram of the frame
+		times, and keeps the captured frames for a CSV export.
+	*/
+	class PaintStatsOverlay : public QWidget {
+		public:
+		PaintStatsOverlay(QWidget * = 0);
+		void addFrame(const PaintStats::Frame &);
+		void clear();
+		bool exportCsv(const QString &) const;
+
+		protected:
+		void paintEvent(QPaintEvent *);
+
+		private:
+		/// the last frames, used for the rolling histogram
+		QVector<PaintStats::Frame> recentes;
+		int prochaine;
+		/// every frame captured since the overlay was shown
+		QVector<PaintStats::Frame> capturees;
+		static int classeHistogramme(qint64);
+	};
+#endif
@@ -14,29 +14,63 @@ HEADERS += aboutqet.h \
            contactor.h \
            del.h \
            element.h \
-           FixedElement.h \
+           elementfixe.h \
            elementperso.h \
            entree.h \
            panelappareils.h \
            qetapp.h \
            schema.h \
-           schemaview.h
+           schemaview.h \
+           paintstats.h \
+           spatialindex.h \
+           elementdefinition.h \
+           conductorrouter.h \
+           conductorbundle.h \
+           crossingfinder.h \
+           netconnectivity.h \
+           netlistexporter.h \
+           ercpanel.h \
+           ercchecker.h \
+           bomgenerator.h \
+           schemamodel.h \
+           schemadiff.h \
+           schemamerge.h \
+           contenthash.h \
+           groupmove.h \
+           destructionqueue.h
 SOURCES += aboutqet.cpp \
             terminal.cpp \
            conductor.cpp \
            contactor.cpp \
            del.cpp \
            element.cpp \
-           FixedElement.cpp \
+           elementfixe.cpp \
            elementperso.cpp \
            entree.cpp \
            main.cpp \
            panelappareils.cpp \
            qetapp.cpp \
            schema.cpp \
-           schemaview.cpp
+           schemaview.cpp \
+           paintstats.cpp \
+           elementdefinition.cpp \
+           conductorrouter.cpp \
+           conductorbundle.cpp \
+           crossingfinder.cpp \
+           netconnectivity.cpp \
+           netlistexporter.cpp \
+           ercpanel.cpp \
+           ercchecker.cpp \
+           bomgenerator.cpp \
+           schemamodel.cpp \
+           schemadiff.cpp \
+           schemamerge.cpp \
+           contenthash.cpp \
+           groupmove.cpp \
+           destructionqueue.cpp
 RESOURCES += qelectrotech.qrc
 TRANSLATIONS += qet_en.ts
 QT += xml
 QT += widgets
-QT += printsupport
\ No newline at end of file
+QT += printsupport
+QT += svg
\ No newline at end of file
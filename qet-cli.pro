@@ -0,0 +1,59 @@
+######################################################################
+# Outil en ligne de commande de QElectroTech (sans interface graphique)
+######################################################################
+
+TEMPLATE = app
+TARGET = qet-cli
+CONFIG += console
+CONFIG -= app_bundle
+DEPENDPATH += .
+INCLUDEPATH += .
+
+# Input
+HEADERS += batchprocessor.h \
+           terminal.h \
+           conductor.h \
+           element.h \
+           elementfixe.h \
+           elementperso.h \
+           schema.h \
+           paintstats.h \
+           spatialindex.h \
+           elementdefinition.h \
+           conductorrouter.h \
+           conductorbundle.h \
+           crossingfinder.h \
+           netconnectivity.h \
+           netlistexporter.h \
+           bomgenerator.h \
+           schemamodel.h \
+           schemadiff.h \
+           schemamerge.h \
+           contenthash.h \
+           groupmove.h \
+           destructionqueue.h
+SOURCES += qetcli.cpp \
+           batchprocessor.cpp \
+           terminal.cpp \
+           conductor.cpp \
+           element.cpp \
+           elementfixe.cpp \
+           elementperso.cpp \
+           schema.cpp \
+           paintstats.cpp \
+           elementdefinition.cpp \
+           conductorrouter.cpp \
+           conductorbundle.cpp \
+           crossingfinder.cpp \
+           netconnectivity.cpp \
+           netlistexporter.cpp \
+           bomgenerator.cpp \
+           schemamodel.cpp \
+           schemadiff.cpp \
+           schemamerge.cpp \
+           contenthash.cpp \
+           groupmove.cpp \
+           destructionqueue.cpp
+QT += xml
+QT += widgets
+QT += svg
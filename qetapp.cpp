@@ -1,7 +1,11 @@
 #include "qetapp.h"
 #include "schemaview.h"
 #include "schema.h"
+#include "element.h"
+#include "netlistexporter.h"
+#include "bomgenerator.h"
 #include "panelappareils.h"
+#include "ercpanel.h"
 #include "aboutqet.h"
 #include <QtDebug>
 #include "debug.h"
@@ -71,6 +75,14 @@ QETApp::QETApp(QWidget *parent) : QMainWindow(parent) {
 	qdw_pa -> setWidget(pa = new PanelAppareils(qdw_pa));
 	addDockWidget(Qt::LeftDockWidgetArea, qdw_pa);
 	
+	// ajout du panel de verification electrique en tant que QDockWidget
+	qdw_erc = new QDockWidget(tr("Verification electrique"), this);
+	qdw_erc -> setAllowedAreas(Qt::AllDockWidgetAreas);
+	qdw_erc -> setFeatures(QDockWidget::AllDockWidgetFeatures);
+	qdw_erc -> setWidget(erc = new ErcPanel(qdw_erc));
+	addDockWidget(Qt::BottomDockWidgetArea, qdw_erc);
+	erc -> setSchemaView(schemaInProgress());
+	
 	// mise en place des actions
 	actions();
 	
@@ -204,6 +216,36 @@ void QETApp::toggleAntialiasing() {
 	toggle_aa -> setText(sv -> antialiased() ? tr("D\351sactiver l'&antialiasing") : tr("Activer l'&antialiasing"));
 }
 
+/**
+	Affiche ou masque la surcouche de statistiques de rendu du Schema courant
+*/
+void QETApp::toggleStatistics() {
+	SchemaView *sv = schemaInProgress();
+	if (!sv) return;
+	sv -> setStatisticsShown(!sv -> statisticsShown());
+	slot_updateActions();
+}
+
+/**
+	Active ou desactive le rendu des conducteurs en une seule passe sur le Schema courant
+*/
+void QETApp::toggleConductorLayer() {
+	SchemaView *sv = schemaInProgress();
+	if (!sv) return;
+	sv -> scene -> setConductorLayer(!sv -> scene -> conductorLayer());
+	slot_updateActions();
+}
+
+/**
+	Active ou desactive le routage automatique des conducteurs du schema en cours
+*/
+void QETApp::toggleAutoRouting() {
+	SchemaView *sv = schemaInProgress();
+	if (!sv) return;
+	sv -> scene -> setAutoRouting(!sv -> scene -> autoRouting());
+	slot_updateActions();
+}
+
 /**
 	Dialogue  A propos de QElectroTech 
 	Le dialogue en question est cree lors du premier appel de cette fonction.
@@ -241,8 +283,16 @@ void QETApp::actions() {
 	sel_inverse       = new QAction(                               tr("Inverser la s\351lection"),       this);
 	supprimer         = new QAction(QIcon(":/ico/delete.png"),     tr("Supprimer"),                      this);
 	pivoter           = new QAction(QIcon(":/ico/pivoter.png"),    tr("Pivoter"),                        this);
+	rerouter          = new QAction(                               tr("Rerouter tous les conducteurs"),  this);
+	regrouper         = new QAction(                               tr("Regrouper en faisceau"),          this);
 	
 	toggle_aa         = new QAction(                               tr("D\351sactiver l'&antialiasing"),  this);
+	toggle_stats      = new QAction(                               tr("Statistiques de &rendu"),         this);
+	exporter_stats    = new QAction(                               tr("Exporter les statistiques..."),   this);
+	exporter_netlist  = new QAction(                               tr("Exporter la netlist..."),         this);
+	exporter_nomenclature = new QAction(                           tr("Exporter la nomenclature..."),    this);
+	toggle_couche     = new QAction(                               tr("Conducteurs en une &passe"),      this);
+	toggle_routage    = new QAction(                               tr("R&outage automatique"),           this);
 	zoom_avant        = new QAction(QIcon(":/ico/viewmag+.png"),   tr("Zoom avant"),                     this);
 	zoom_arriere      = new QAction(QIcon(":/ico/viewmag-.png"),   tr("Zoom arri\350re"),                this);
 	zoom_adapte       = new QAction(QIcon(":/ico/viewmagfit.png"), tr("Zoom adapt\351"),                 this);
@@ -310,6 +360,9 @@ void QETApp::actions() {
 	// traitements speciaux
 	mode_selection    -> setCheckable(true);
 	mode_visualise    -> setCheckable(true);
+	toggle_stats      -> setCheckable(true);
+	toggle_couche     -> setCheckable(true);
+	toggle_routage    -> setCheckable(true);
 	mode_selection    -> setChecked(true);
 	
 	QActionGroup *grp_visu_sel = new QActionGroup(this);
@@ -324,6 +377,8 @@ void QETApp::actions() {
 	connect(sel_inverse,      SIGNAL(triggered()), this,       SLOT(slot_selectInvert())        );
 	connect(supprimer,        SIGNAL(triggered()), this,       SLOT(slot_supprimer())           );
 	connect(pivoter,          SIGNAL(triggered()), this,       SLOT(slot_pivoter())             );
+	connect(rerouter,         SIGNAL(triggered()), this,       SLOT(slot_rerouter())            );
+	connect(regrouper,        SIGNAL(triggered()), this,       SLOT(slot_regrouper())           );
 	connect(entrer_pe,        SIGNAL(triggered()), this,       SLOT(toggleFullScreen())         );
 	connect(sortir_pe,        SIGNAL(triggered()), this,       SLOT(toggleFullScreen())         );
 	connect(mode_selection,   SIGNAL(triggered()), this,       SLOT(slot_setSelectionMode())    );
@@ -347,6 +402,12 @@ void QETApp::actions() {
 	connect(copier,           SIGNAL(triggered()), this,       SLOT(slot_copier())              );
 	connect(coller,           SIGNAL(triggered()), this,       SLOT(slot_paste())              );
 	connect(toggle_aa,        SIGNAL(triggered()), this,       SLOT(toggleAntialiasing())       );
+	connect(toggle_stats,     SIGNAL(triggered()), this,       SLOT(toggleStatistics())         );
+	connect(exporter_stats,   SIGNAL(triggered()), this,       SLOT(dialogue_exporter_statistiques()));
+	connect(exporter_netlist, SIGNAL(triggered()), this,       SLOT(dialogue_exporter_netlist())  );
+	connect(exporter_nomenclature, SIGNAL(triggered()), this,  SLOT(dialogue_exporter_nomenclature()));
+	connect(toggle_couche,    SIGNAL(triggered()), this,       SLOT(toggleConductorLayer())     );
+	connect(toggle_routage,   SIGNAL(triggered()), this,       SLOT(toggleAutoRouting())        );
 	connect(f_mosaique,       SIGNAL(triggered()), &workspace, SLOT(tile()));
 	connect(f_cascade,        SIGNAL(triggered()), &workspace, SLOT(cascade()));
 	connect(f_reorganise,     SIGNAL(triggered()), &workspace, SLOT(arrangeIcons()));
@@ -383,6 +444,8 @@ void QETApp::menus() {
 	menu_fichier -> addSeparator();
 	menu_fichier -> addAction(importer);
 	menu_fichier -> addAction(exporter);
+	menu_fichier -> addAction(exporter_netlist);
+	menu_fichier -> addAction(exporter_nomenclature);
 	menu_fichier -> addSeparator();
 	menu_fichier -> addAction(imprimer);
 	menu_fichier -> addSeparator();
@@ -402,16 +465,23 @@ void QETApp::menus() {
 	menu_edition -> addSeparator();
 	menu_edition -> addAction(supprimer);
 	menu_edition -> addAction(pivoter);
+	menu_edition -> addAction(rerouter);
+	menu_edition -> addAction(regrouper);
 	
 	// menu Affichage > Pinup
 	QMenu *menu_aff_aff = new QMenu(tr("Pinup"));
 	menu_aff_aff -> addAction(barre_outils -> toggleViewAction());
 	menu_aff_aff -> addAction(qdw_pa -> toggleViewAction());
+	menu_aff_aff -> addAction(qdw_erc -> toggleViewAction());
 	
 	// menu Affichage
 	menu_affichage -> addMenu(menu_aff_aff);
 	menu_affichage -> addSeparator();
 	menu_affichage -> addAction(toggle_aa);
+	menu_affichage -> addAction(toggle_couche);
+	menu_affichage -> addAction(toggle_routage);
+	menu_affichage -> addAction(toggle_stats);
+	menu_affichage -> addAction(exporter_stats);
 	menu_affichage -> addSeparator();
 	menu_affichage -> addAction(zoom_avant);
 	menu_affichage -> addAction(zoom_arriere);
@@ -488,6 +558,96 @@ void QETApp::dialogue_exporter() {
 	}
 }
 
+/**
+	Exporte la netlist du schema courant, au format SPICE ou CSV
+*/
+void QETApp::dialogue_exporter_netlist() {
+	SchemaView *sv = schemaInProgress();
+	if (!sv) return;
+	QString filtre_choisi;
+	QString nom_fichier = QFileDialog::getSaveFileName(
+		this,
+		tr("Exporter la netlist"),
+		QDir::homePath(),
+		tr("Netlist SPICE (*.cir);;Fichier CSV (*.csv)"),
+		&filtre_choisi
+	);
+	if (nom_fichier == "") return;
+	NetlistExporter::Format format = filtre_choisi.contains("*.csv") ? NetlistExporter::Csv : NetlistExporter::Spice;
+	QString extension = format == NetlistExporter::Csv ? ".csv" : ".cir";
+	if (!nom_fichier.endsWith(extension, Qt::CaseInsensitive)) nom_fichier += extension;
+	NetlistExporter netlist(sv -> scene);
+	if (!netlist.write(nom_fichier, format)) {
+		QMessageBox::warning(this, tr("Erreur"), tr("Impossible d'ecrire dans ce file"));
+	}
+}
+
+/**
+	Exporte la nomenclature du schema courant, ou de tous les schemas ouverts,
+	au format CSV ou HTML
+*/
+void QETApp::dialogue_exporter_nomenclature() {
+	SchemaView *sv = schemaInProgress();
+	if (!sv) return;
+	QList<SchemaView *> vues;
+	vues << sv;
+	QList<QMdiSubWindow *> fenetres = workspace.subWindowList();
+	if (fenetres.size() > 1) {
+		QMessageBox::StandardButton reponse = QMessageBox::question(
+			this,
+			tr("Exporter la nomenclature"),
+			tr("Inclure tous les schemas ouverts dans la nomenclature ?"),
+			QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel
+		);
+		if (reponse == QMessageBox::Cancel) return;
+		if (reponse == QMessageBox::Yes) {
+			vues.clear();
+			foreach(QMdiSubWindow *fenetre, fenetres) {
+				if (SchemaView *v = qobject_cast<SchemaView *>(fenetre -> widget())) vues << v;
+			}
+		}
+	}
+	QString filtre_choisi;
+	QString nom_fichier = QFileDialog::getSaveFileName(
+		this,
+		tr("Exporter la nomenclature"),
+		QDir::homePath(),
+		tr("Fichier CSV (*.csv);;Page HTML (*.html)"),
+		&filtre_choisi
+	);
+	if (nom_fichier == "") return;
+	BomGenerator::Format format = filtre_choisi.contains("*.html") ? BomGenerator::Html : BomGenerator::Csv;
+	QString extension = format == BomGenerator::Html ? ".html" : ".csv";
+	if (!nom_fichier.endsWith(extension, Qt::CaseInsensitive)) nom_fichier += extension;
+	BomGenerator nomenclature;
+	foreach(SchemaView *v, vues) {
+		QString folio = v -> nom_fichier.isEmpty() ? v -> windowTitle() : QFileInfo(v -> nom_fichier).completeBaseName();
+		nomenclature.addSchema(v -> scene, folio);
+	}
+	if (!nomenclature.write(nom_fichier, format)) {
+		QMessageBox::warning(this, tr("Erreur"), tr("Impossible d'ecrire dans ce file"));
+	}
+}
+
+/**
+	Exporte au format CSV les statistiques de rendu capturees par le Schema courant
+*/
+void QETApp::dialogue_exporter_statistiques() {
+	SchemaView *sv = schemaInProgress();
+	if (!sv || !sv -> statisticsShown()) return;
+	QString nom_fichier = QFileDialog::getSaveFileName(
+		this,
+		tr("Exporter les statistiques de rendu"),
+		QDir::homePath(),
+		tr("Fichier CSV (*.csv)")
+	);
+	if (nom_fichier == "") return;
+	if (!nom_fichier.endsWith(".csv", Qt::CaseInsensitive)) nom_fichier += ".csv";
+	if (!sv -> exportStatistics(nom_fichier)) {
+		QMessageBox::warning(this, tr("Erreur"), tr("Impossible d'ecrire dans ce file"));
+	}
+}
+
 /**
 Method saving the schema in the last known queue name.
 If no queue name is known, this method calls the save_as method
@@ -640,6 +800,21 @@ void QETApp::slot_pivoter() {
 	if(schemaInProgress()) schemaInProgress() -> pivoter();
 }
 
+void QETApp::slot_rerouter() {
+	if(schemaInProgress()) schemaInProgress() -> scene -> rerouteAll();
+}
+
+/**
+	Remplace les conducteurs reliant les deux elements selectionnes par un faisceau
+*/
+void QETApp::slot_regrouper() {
+	SchemaView *sv = schemaInProgress();
+	if (!sv) return;
+	if (sv -> scene -> selectedCount() != 2) return;
+	QList<Element *> selection = sv -> scene -> selectedElements();
+	sv -> scene -> bundleConductors(selection.at(0), selection.at(1));
+}
+
 void QETApp::slot_setSelectionMode() {
 	if(schemaInProgress()) schemaInProgress() -> setSelectionMode();
 }
@@ -655,12 +830,17 @@ void QETApp::slot_updateActions() {
 	SchemaView *sv = schemaInProgress();
 	bool document_ouvert = (sv != 0);
 	
+	// le panel de verification suit le schema courant
+	erc -> setSchemaView(sv);
+	
 	// actions that just need an open document
 	fermer_fichier   -> setEnabled(document_ouvert);
 	enr_fichier      -> setEnabled(document_ouvert);
 	enr_fichier_sous -> setEnabled(document_ouvert);
 	importer         -> setEnabled(document_ouvert);
 	exporter         -> setEnabled(document_ouvert);
+	exporter_netlist -> setEnabled(document_ouvert);
+	exporter_nomenclature -> setEnabled(document_ouvert);
 	imprimer         -> setEnabled(document_ouvert);
 	sel_tout         -> setEnabled(document_ouvert);
 	sel_rien         -> setEnabled(document_ouvert);
@@ -670,17 +850,26 @@ void QETApp::slot_updateActions() {
 	zoom_adapte      -> setEnabled(document_ouvert);
 	zoom_reset       -> setEnabled(document_ouvert);
 	toggle_aa        -> setEnabled(document_ouvert);
+	toggle_stats     -> setEnabled(document_ouvert);
+	toggle_stats     -> setChecked(document_ouvert && sv -> statisticsShown());
+	exporter_stats   -> setEnabled(document_ouvert && sv -> statisticsShown());
+	toggle_couche    -> setEnabled(document_ouvert);
+	toggle_couche    -> setChecked(document_ouvert && sv -> scene -> conductorLayer());
+	toggle_routage   -> setEnabled(document_ouvert);
+	rerouter         -> setEnabled(document_ouvert);
+	toggle_routage   -> setChecked(document_ouvert && sv -> scene -> autoRouting());
 	
 	// actions ayant aussi besoin d'un historique des actions
 	annuler          -> setEnabled(document_ouvert);
 	refaire          -> setEnabled(document_ouvert);
 	
 	// actions ayant aussi besoin d'elements selectionnes
-	bool elements_selectionnes = document_ouvert ? (sv -> scene -> selectedItems().size() > 0) : false;
+	bool elements_selectionnes = document_ouvert ? (sv -> scene -> selectedCount() > 0) : false;
 	couper           -> setEnabled(elements_selectionnes);
 	copier           -> setEnabled(elements_selectionnes);
 	supprimer        -> setEnabled(elements_selectionnes);
 	pivoter          -> setEnabled(elements_selectionnes);
+	regrouper        -> setEnabled(elements_selectionnes);
 	
 	// action ayant aussi besoin d'un presse-papier plein
 	bool peut_coller = QApplication::clipboard() -> text() != QString();
@@ -6,6 +6,7 @@
 #include <QPrintDialog>
 	class SchemaView;
 	class PanelAppareils;
+	class ErcPanel;
 	/**
 		Cette classe represente la fenetre principale de QElectroTech et,
 		ipso facto, la plus grande partie de l'interface graphique de QElectroTech.
@@ -26,9 +27,15 @@
 		void quitter();
 		void toggleFullScreen();
 		void toggleAntialiasing();
+		void toggleStatistics();
+		void toggleConductorLayer();
+		void toggleAutoRouting();
 		void aPropos();
 		void dialogue_imprimer();
 		void dialogue_exporter();
+		void dialogue_exporter_statistiques();
+		void dialogue_exporter_netlist();
+		void dialogue_exporter_nomenclature();
 		bool dialogue_enregistrer_sous();
 		bool enregistrer();
 		bool nouveau();
@@ -59,6 +66,8 @@
 		QAction *supprimer;
 		QAction *selectionner;
 		QAction *pivoter;
+		QAction *rerouter;
+		QAction *regrouper;
 		QAction *poser_fil;
 		QAction *masquer_appli;
 		QAction *restaurer_appli;
@@ -72,6 +81,12 @@
 		QAction *entrer_pe;
 		QAction *sortir_pe;
 		QAction *toggle_aa;
+		QAction *toggle_stats;
+		QAction *exporter_stats;
+		QAction *exporter_netlist;
+		QAction *exporter_nomenclature;
+		QAction *toggle_couche;
+		QAction *toggle_routage;
 		QAction *f_mosaique;
 		QAction *f_cascade;
 		QAction *f_reorganise;
@@ -90,6 +105,10 @@
 		QDockWidget *qdw_pa;
 		/// Panel d'Appareils
 		PanelAppareils *pa;
+		/// Dock pour le panel de verification electrique
+		QDockWidget *qdw_erc;
+		/// Panel de verification electrique
+		ErcPanel *erc;
 		/// Elements de menus pour l'icone du systray
 		QMenu *menu_systray;
 		QAction *systray_masquer;
@@ -117,6 +136,8 @@
 		void slot_selectInvert();
 		void slot_supprimer();
 		void slot_pivoter();
+		void slot_rerouter();
+		void slot_regrouper();
 		void slot_setSelectionMode();
 		void slot_setVisualisationMode();
 		void slot_updateActions();
@@ -0,0 +1,931 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include "schema.h"
+#include "elementdefinition.h"
+#include "batchprocessor.h"
+#include "elementperso.h"
+#include "conductor.h"
+#include "groupmove.h"
+#include "netlistexporter.h"
+#include "bomgenerator.h"
+#include "schemamodel.h"
+#include "schemadiff.h"
+#include "schemamerge.h"
+#include "destructionqueue.h"
+#include <QtDebug>
+
+/**
+	Outil en ligne de commande de QElectroTech : les schemas sont charges avec
+	la meme logique que l'interface graphique (Schema::fromXml), mais sans
+	fenetre, sur la plateforme Qt "offscreen". Utilisable sur un serveur sans
+	affichage.
+*/
+
+/**
+	@return Le flux de la sortie d'erreur
+*/
+static QTextStream &sortieErreur() {
+	static QTextStream flux(stderr);
+	return(flux);
+}
+
+/**
+	Affiche le debit d'un traitement portant sur plusieurs fichiers
+	@param nb_fichiers Nombre de fichiers traites
+	@param nb_echecs Nombre de fichiers dont le traitement a echoue
+	@param duree_ms Duree totale du traitement en millisecondes
+*/
+static void afficherDebit(int nb_fichiers, int nb_echecs, qint64 duree_ms) {
+	double secondes = duree_ms / 1000.0;
+	double debit = secondes > 0.0 ? nb_fichiers / secondes : 0.0;
+	sortieErreur() << nb_fichiers << " fichier(s) en " << QString::number(secondes, 'f', 3) << " s (";
+	sortieErreur() << QString::number(debit, 'f', 1) << " fichiers/s), " << nb_echecs << " echec(s)" << endl;
+}
+
+/**
+	@param entree Chemin d'un fichier d'entree
+	@param dossier Dossier de sortie ; s'il est vide, le dossier du fichier d'entree est utilise
+	@param extension Extension du fichier de sortie
+	@return Le chemin du fichier de sortie correspondant au fichier d'entree
+*/
+static QString cheminSortie(const QString &entree, const QString &dossier, const QString &extension) {
+	QFileInfo info(entree);
+	QDir destination(dossier.isEmpty() ? info.absolutePath() : dossier);
+	return(destination.filePath(info.completeBaseName() + "." + extension));
+}
+
+/**
+	Commandes "export" et "convert" : chaque fichier est charge dans un
+	nouveau Schema puis exporte (png, svg, pdf) ou reenregistre (qet).
+	@param args Arguments de la commande (le premier est le nom du programme)
+	@param conversion true pour la commande "convert", false pour "export"
+	@return Le code de retour du programme
+*/
+static int commandeExport(const QStringList &args, bool conversion) {
+	QCommandLineParser parseur;
+	parseur.addHelpOption();
+	QCommandLineOption option_format(QStringList() << "f" << "format", "Format d'export : png, svg ou pdf.", "format", "png");
+	QCommandLineOption option_sortie(QStringList() << "o" << "output", "Dossier de sortie (par defaut : celui de chaque fichier).", "dossier");
+	if (!conversion) parseur.addOption(option_format);
+	parseur.addOption(option_sortie);
+	parseur.addPositionalArgument("fichiers", "Schemas *.qet a traiter.", "fichier.qet...");
+	parseur.process(args);
+
+	QString format = conversion ? QString("qet") : parseur.value(option_format).toLower();
+	if (format != "png" && format != "svg" && format != "pdf" && format != "qet") {
+		sortieErreur() << "Format inconnu : " << format << endl;
+		return(2);
+	}
+	QStringList fichiers = parseur.positionalArguments();
+	if (fichiers.isEmpty()) parseur.showHelp(2);
+	QString dossier = parseur.value(option_sortie);
+	if (!dossier.isEmpty()) QDir().mkpath(dossier);
+
+	int nb_echecs = 0;
+	QElapsedTimer chrono;
+	chrono.start();
+	foreach(QString fichier, fichiers) {
+		int erreur;
+		Schema schema;
+		if (!schema.fromFile(fichier, &erreur)) {
+			sortieErreur() << fichier << " : chargement impossible (erreur " << erreur << ")" << endl;
+			++ nb_echecs;
+			continue;
+		}
+		QString sortie = cheminSortie(fichier, dossier, format);
+		if (!schema.exportTo(sortie, format)) {
+			sortieErreur() << fichier << " : ecriture de " << sortie << " impossible" << endl;
+			++ nb_echecs;
+		}
+	}
+	afficherDebit(fichiers.size(), nb_echecs, chrono.elapsed());
+	return(nb_echecs ? 1 : 0);
+}
+
+/**
+	Commande "batch" : valide, exporte ou convertit tous les schemas d'une ou
+	plusieurs arborescences sur plusieurs threads.
+	@param args Arguments de la commande (le premier est le nom du programme)
+	@return Le code de retour du programme
+*/
+static int commandeBatch(const QStringList &args) {
+	QCommandLineParser parseur;
+	parseur.addHelpOption();
+	QCommandLineOption option_format(QStringList() << "f" << "format", "Format d'export : png, svg ou pdf.", "format", "png");
+	QCommandLineOption option_sortie(QStringList() << "o" << "output", "Dossier de sortie (par defaut : celui de chaque fichier).", "dossier");
+	QCommandLineOption option_jobs(QStringList() << "j" << "jobs", "Nombre de threads (par defaut : un par coeur).", "n", "0");
+	QCommandLineOption option_rapport(QStringList() << "r" << "report", "Fichier du rapport detaille (CSV).", "fichier");
+	parseur.addOption(option_format);
+	parseur.addOption(option_sortie);
+	parseur.addOption(option_jobs);
+	parseur.addOption(option_rapport);
+	parseur.addPositionalArgument("operation", "validate, export ou convert.");
+	parseur.addPositionalArgument("chemins", "Dossiers ou schemas *.qet a traiter.", "chemin...");
+	parseur.process(args);
+	
+	QStringList positionnels = parseur.positionalArguments();
+	if (positionnels.size() < 2) parseur.showHelp(2);
+	QString nom_operation = positionnels.takeFirst();
+	BatchProcessor::Operation operation;
+	if (nom_operation == "validate") operation = BatchProcessor::Validation;
+	else if (nom_operation == "export") operation = BatchProcessor::Export;
+	else if (nom_operation == "convert") operation = BatchProcessor::Conversion;
+	else {
+		sortieErreur() << "Operation inconnue : " << nom_operation << endl;
+		return(2);
+	}
+	QString format = parseur.value(option_format).toLower();
+	if (operation == BatchProcessor::Export && format != "png" && format != "svg" && format != "pdf") {
+		sortieErreur() << "Format inconnu : " << format << endl;
+		return(2);
+	}
+	
+	// collecte des schemas ; l'arborescence d'un dossier est reproduite dans le dossier de sortie
+	QStringList fichiers;
+	QString racine;
+	foreach(QString chemin, positionnels) {
+		if (QFileInfo(chemin).isDir()) {
+			fichiers << BatchProcessor::collectFiles(chemin);
+			if (racine.isEmpty()) racine = chemin;
+		} else fichiers << chemin;
+	}
+	if (fichiers.isEmpty()) {
+		sortieErreur() << "Aucun schema a traiter" << endl;
+		return(2);
+	}
+	
+	// les definitions sont chargees avant le demarrage des threads, qui ne font ensuite que lire le cache
+	ElementDefinition::preload("elements");
+	
+	BatchProcessor processeur(operation, format);
+	processeur.setOutput(racine, parseur.value(option_sortie));
+	processeur.setJobs(parseur.value(option_jobs).toInt());
+	QElapsedTimer chrono;
+	chrono.start();
+	QVector<BatchProcessor::Resultat> resultats = processeur.run(fichiers);
+	qint64 duree = chrono.elapsed();
+	
+	int nb_echecs = 0;
+	foreach(const BatchProcessor::Resultat &r, resultats) {
+		if (r.reussi) continue;
+		sortieErreur() << r.fichier << " : " << r.message << endl;
+		++ nb_echecs;
+	}
+	sortieErreur() << processeur.jobs() << " thread(s)" << endl;
+	afficherDebit(resultats.size(), nb_echecs, duree);
+	QString rapport = parseur.value(option_rapport);
+	if (!rapport.isEmpty() && !BatchProcessor::writeReport(rapport, resultats, duree)) {
+		sortieErreur() << "Ecriture du rapport " << rapport << " impossible" << endl;
+		return(1);
+	}
+	return(nb_echecs ? 1 : 0);
+}
+
+/**
+	Commande "netlist" : ecrit la netlist de chaque schema, au format SPICE ou CSV
+	@param args Arguments de la commande (le premier est le nom du programme)
+	@return Le code de retour du programme
+*/
+static int commandeNetlist(const QStringList &args) {
+	QCommandLineParser parseur;
+	parseur.addHelpOption();
+	QCommandLineOption option_format(QStringList() << "f" << "format", "Format de la netlist : spice ou csv.", "format", "spice");
+	QCommandLineOption option_sortie(QStringList() << "o" << "output", "Dossier de sortie (par defaut : celui de chaque fichier).", "dossier");
+	parseur.addOption(option_format);
+	parseur.addOption(option_sortie);
+	parseur.addPositionalArgument("fichiers", "Schemas *.qet a traiter.", "fichier.qet...");
+	parseur.process(args);
+	
+	NetlistExporter::Format format;
+	if (!NetlistExporter::formatFromName(parseur.value(option_format), &format)) {
+		sortieErreur() << "Format inconnu : " << parseur.value(option_format) << endl;
+		return(2);
+	}
+	QStringList fichiers = parseur.positionalArguments();
+	if (fichiers.isEmpty()) parseur.showHelp(2);
+	QString dossier = parseur.value(option_sortie);
+	if (!dossier.isEmpty()) QDir().mkpath(dossier);
+	
+	int nb_echecs = 0;
+	QElapsedTimer chrono;
+	chrono.start();
+	foreach(QString fichier, fichiers) {
+		int erreur;
+		Schema schema;
+		if (!schema.fromFile(fichier, &erreur)) {
+			sortieErreur() << fichier << " : chargement impossible (erreur " << erreur << ")" << endl;
+			++ nb_echecs;
+			continue;
+		}
+		QString sortie = cheminSortie(fichier, dossier, format == NetlistExporter::Csv ? "csv" : "cir");
+		NetlistExporter netlist(&schema);
+		if (!netlist.write(sortie, format)) {
+			sortieErreur() << fichier << " : ecriture de " << sortie << " impossible" << endl;
+			++ nb_echecs;
+			continue;
+		}
+		sortieErreur() << fichier << " : " << netlist.terminalCount() << " borne(s), " << netlist.netCount() << " reseau(x)" << endl;
+	}
+	afficherDebit(fichiers.size(), nb_echecs, chrono.elapsed());
+	return(nb_echecs ? 1 : 0);
+}
+
+/**
+	Commande "bom" : nomenclature de tous les schemas des chemins donnes. Les
+	fichiers sont lus en flux, sans instancier les elements.
+	@param args Arguments de la commande (le premier est le nom du programme)
+	@return Le code de retour du programme
+*/
+static int commandeBom(const QStringList &args) {
+	QCommandLineParser parseur;
+	parseur.addHelpOption();
+	QCommandLineOption option_format(QStringList() << "f" << "format", "Format de la nomenclature : csv ou html.", "format", "csv");
+	QCommandLineOption option_sortie(QStringList() << "o" << "output", "Fichier de sortie (par defaut : sortie standard).", "fichier");
+	parseur.addOption(option_format);
+	parseur.addOption(option_sortie);
+	parseur.addPositionalArgument("chemins", "Dossiers ou schemas *.qet a traiter.", "chemin...");
+	parseur.process(args);
+	
+	BomGenerator::Format format;
+	if (!BomGenerator::formatFromName(parseur.value(option_format), &format)) {
+		sortieErreur() << "Format inconnu : " << parseur.value(option_format) << endl;
+		return(2);
+	}
+	QStringList fichiers;
+	foreach(QString chemin, parseur.positionalArguments()) {
+		if (QFileInfo(chemin).isDir()) fichiers << BatchProcessor::collectFiles(chemin);
+		else fichiers << chemin;
+	}
+	if (fichiers.isEmpty()) parseur.showHelp(2);
+	
+	int nb_echecs = 0;
+	QElapsedTimer chrono;
+	chrono.start();
+	BomGenerator nomenclature;
+	foreach(QString fichier, fichiers) {
+		if (nomenclature.addFile(fichier)) continue;
+		sortieErreur() << fichier << " : lecture impossible" << endl;
+		++ nb_echecs;
+	}
+	
+	bool ecrit;
+	QString sortie = parseur.value(option_sortie);
+	if (sortie.isEmpty()) {
+		QFile sortie_standard;
+		sortie_standard.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+		ecrit = nomenclature.write(&sortie_standard, format);
+	} else ecrit = nomenclature.write(sortie, format);
+	if (!ecrit) {
+		sortieErreur() << "Ecriture de la nomenclature impossible" << endl;
+		return(1);
+	}
+	sortieErreur() << nomenclature.elementCount() << " element(s), " << nomenclature.lineCount() << " type(s)" << endl;
+	afficherDebit(fichiers.size(), nb_echecs, chrono.elapsed());
+	return(nb_echecs ? 1 : 0);
+}
+
+/**
+	Commande "diff" : differences structurelles entre deux revisions d'un
+	schema. La liste des differences est ecrite sur la sortie standard ; l'option
+	-o produit en plus un rendu de la nouvelle revision annote des differences.
+	@param args Arguments de la commande (le premier est le nom du programme)
+	@return 0 si les revisions sont identiques, 1 si elles different, 2 en cas d'erreur
+*/
+static int commandeDiff(const QStringList &args) {
+	QCommandLineParser parseur;
+	parseur.addHelpOption();
+	QCommandLineOption option_sortie(QStringList() << "o" << "output", "Image (png) de la nouvelle revision annotee des differences.", "fichier");
+	parseur.addOption(option_sortie);
+	parseur.addPositionalArgument("ancien", "Ancienne revision du schema.", "ancien.qet");
+	parseur.addPositionalArgument("nouveau", "Nouvelle revision du schema.", "nouveau.qet");
+	parseur.process(args);
+	QStringList fichiers = parseur.positionalArguments();
+	if (fichiers.size() != 2) parseur.showHelp(2);
+	
+	QElapsedTimer chrono;
+	chrono.start();
+	SchemaModel ancien, nouveau;
+	QString erreur;
+	if (!ancien.load(fichiers.at(0), &erreur) || !nouveau.load(fichiers.at(1), &erreur)) {
+		sortieErreur() << "Lecture impossible : " << erreur << endl;
+		return(2);
+	}
+	SchemaDiff diff(ancien, nouveau);
+	QTextStream sortie_standard(stdout);
+	diff.writeReport(sortie_standard);
+	sortie_standard.flush();
+	
+	QString sortie = parseur.value(option_sortie);
+	if (!sortie.isEmpty()) {
+		Schema schema;
+		int erreur_chargement;
+		if (!schema.fromFile(fichiers.at(1), &erreur_chargement)) {
+			sortieErreur() << fichiers.at(1) << " : chargement impossible (erreur " << erreur_chargement << ")" << endl;
+			return(2);
+		}
+		schema.flushConductors();
+		// les elements supprimes doivent rester visibles
+		QRectF zone = schema.itemsBoundingRect();
+		foreach(int i, diff.removed()) zone |= SchemaDiff::elementRect(ancien.elements.at(i));
+		zone.adjust(-10.0, -10.0, 10.0, 10.0);
+		QImage rendu(zone.size().toSize(), QImage::Format_ARGB32);
+		rendu.fill(Qt::white);
+		QPainter p(&rendu);
+		p.setRenderHint(QPainter::Antialiasing, true);
+		schema.render(&p, QRectF(rendu.rect()), zone);
+		p.end();
+		if (!diff.renderOverlay(rendu, zone).save(sortie, "PNG")) {
+			sortieErreur() << "Ecriture de " << sortie << " impossible" << endl;
+			return(2);
+		}
+	}
+	sortieErreur() << diff.removed().size() << " element(s) supprime(s), " << diff.added().size() << " ajoute(s), " << diff.moved().size() << " deplace(s), ";
+	sortieErreur() << diff.removedConnections().size() << " conducteur(s) supprime(s), " << diff.addedConnections().size() << " ajoute(s)" << endl;
+	afficherDebit(2, 0, chrono.elapsed());
+	return(diff.isEmpty() ? 0 : 1);
+}
+
+/**
+	Ajoute a un modele un faisceau de deux conducteurs entre deux elements
+	@param modele Le modele a completer
+	@param a Premier element
+	@param b Second element
+	@param numero Numero du faisceau dans le fichier
+*/
+static void ajouteFaisceau(SchemaModel &modele, int a, int b, const QString &numero) {
+	for (int borne = 0 ; borne < 2 ; ++ borne) {
+		SchemaModel::Conducteur c = { { a, borne }, { b, borne }, numero };
+		modele.conducteurs << c;
+	}
+}
+
+/**
+	Cas de fusion verifie par "merge --self-test" : les numeros de faisceaux
+	ne sont que des rangs dans chaque fichier. Dans la revision commune, A
+	porte le numero 0 et B le numero 1 ; de leur cote, A est supprime (B passe
+	a 0) et C est ajoute avec le numero 1 ; de notre cote, rien ne change. Le
+	resultat doit garder B et C dans deux faisceaux distincts.
+	@return true si la fusion donne le resultat attendu
+*/
+static bool verifieFusionFaisceaux() {
+	SchemaModel base;
+	for (int i = 0 ; i < 6 ; ++ i) {
+		SchemaModel::Elmt e;
+		e.type = "contacteur.elmt";
+		e.pos = QPointF(i * 100.0, 0.0);
+		e.sens = true;
+		e.selectionne = false;
+		SchemaModel::Borne b1 = { 0.0, 0.0, 0 };
+		SchemaModel::Borne b2 = { 0.0, 60.0, 2 };
+		e.bornes << b1 << b2;
+		base.elements << e;
+	}
+	SchemaModel eux = base;
+	ajouteFaisceau(base, 0, 1, "0");
+	ajouteFaisceau(base, 2, 3, "1");
+	SchemaModel nous = base;
+	ajouteFaisceau(eux, 2, 3, "0");
+	ajouteFaisceau(eux, 4, 5, "1");
+	
+	SchemaMerge fusion(base, nous, eux);
+	// chaque faisceau du resultat doit relier une seule paire d'elements
+	QHash<QString, QSet<QPair<int, int> > > paires;
+	foreach(const SchemaModel::Conducteur &c, fusion.result().conducteurs) {
+		paires[c.faisceau] << qMakePair(c.e1.element, c.e2.element);
+	}
+	bool ok = !fusion.hasConflicts() && fusion.result().conducteurs.size() == 4 && paires.size() == 2;
+	foreach(const QSet<QPair<int, int> > &p, paires) ok = ok && p.size() == 1;
+	return(ok);
+}
+
+/**
+	Commande "merge" : fusion a trois voies de deux revisions d'un schema. Sans
+	l'option -o, le resultat remplace notre revision, ce qui permet d'utiliser
+	la commande comme pilote de fusion de git :
+	  git config merge.qet.driver "qet-cli merge %O %A %B"
+	  echo "*.qet merge=qet" >> .gitattributes
+	@param args Arguments de la commande (le premier est le nom du programme)
+	@return 0 si la fusion est complete, 1 en cas de conflit, 2 en cas d'erreur
+*/
+static int commandeMerge(const QStringList &args) {
+	QCommandLineParser parseur;
+	parseur.addHelpOption();
+	QCommandLineOption option_sortie(QStringList() << "o" << "output", "Schema fusionne (par defaut : remplace notre revision).", "fichier");
+	QCommandLineOption option_verification("self-test", "Verifie la fusion sur des cas integres, sans fichier.");
+	parseur.addOption(option_sortie);
+	parseur.addOption(option_verification);
+	parseur.addPositionalArgument("base", "Revision commune.", "base.qet");
+	parseur.addPositionalArgument("nous", "Notre revision.", "nous.qet");
+	parseur.addPositionalArgument("eux", "Leur revision.", "eux.qet");
+	parseur.process(args);
+	if (parseur.isSet(option_verification)) {
+		bool ok = verifieFusionFaisceaux();
+		sortieErreur() << "renumerotation des faisceaux : " << (ok ? "ok" : "echec") << endl;
+		return(ok ? 0 : 1);
+	}
+	QStringList fichiers = parseur.positionalArguments();
+	if (fichiers.size() != 3) parseur.showHelp(2);
+	
+	QElapsedTimer chrono;
+	chrono.start();
+	SchemaModel revisions[3];
+	for (int i = 0 ; i < 3 ; ++ i) {
+		QString erreur;
+		if (revisions[i].load(fichiers.at(i), &erreur)) continue;
+		sortieErreur() << fichiers.at(i) << " : lecture impossible : " << erreur << endl;
+		return(2);
+	}
+	SchemaMerge fusion(revisions[0], revisions[1], revisions[2]);
+	QString sortie = parseur.value(option_sortie);
+	if (sortie.isEmpty()) sortie = fichiers.at(1);
+	if (!fusion.result().save(sortie)) {
+		sortieErreur() << "Ecriture de " << sortie << " impossible" << endl;
+		return(2);
+	}
+	foreach(QString conflit, fusion.conflicts()) sortieErreur() << "conflit : " << conflit << endl;
+	sortieErreur() << fusion.result().elements.size() << " element(s), " << fusion.result().conducteurs.size() << " conducteur(s), " << fusion.conflicts().size() << " conflit(s)" << endl;
+	afficherDebit(3, 0, chrono.elapsed());
+	return(fusion.hasConflicts() ? 1 : 0);
+}
+
+/**
+	Commande "hash" : empreinte canonique du contenu de chaque schema, ecrite
+	sur la sortie standard. Deux schemas identiques ont la meme empreinte, quel
+	que soit l'ordre de leurs items dans le fichier.
+	@param args Arguments de la commande (le premier est le nom du programme)
+	@return Le code de retour du programme
+*/
+static int commandeHash(const QStringList &args) {
+	QCommandLineParser parseur;
+	parseur.addHelpOption();
+	QCommandLineOption option_doublons(QStringList() << "d" << "duplicates", "N'affiche que les schemas ayant la meme empreinte qu'un autre.");
+	parseur.addOption(option_doublons);
+	parseur.addPositionalArgument("chemins", "Dossiers ou schemas *.qet a traiter.", "chemin...");
+	parseur.process(args);
+	
+	QStringList fichiers;
+	foreach(QString chemin, parseur.positionalArguments()) {
+		if (QFileInfo(chemin).isDir()) fichiers << BatchProcessor::collectFiles(chemin);
+		else fichiers << chemin;
+	}
+	if (fichiers.isEmpty()) parseur.showHelp(2);
+	bool doublons = parseur.isSet(option_doublons);
+	
+	int nb_echecs = 0;
+	QElapsedTimer chrono;
+	chrono.start();
+	QTextStream sortie_standard(stdout);
+	QMap<quint64, QStringList> empreintes;
+	// un seul schema est reutilise pour tous les fichiers
+	Schema schema;
+	foreach(QString fichier, fichiers) {
+		int erreur;
+		schema.reset();
+		if (!schema.fromFile(fichier, &erreur)) {
+			sortieErreur() << fichier << " : chargement impossible (erreur " << erreur << ")" << endl;
+			++ nb_echecs;
+			continue;
+		}
+		quint64 empreinte = schema.contentHash();
+		if (doublons) empreintes[empreinte] << fichier;
+		else sortie_standard << QString("%1").arg(empreinte, 16, 16, QChar('0')) << "  " << fichier << endl;
+	}
+	for (QMap<quint64, QStringList>::const_iterator it = empreintes.constBegin() ; it != empreintes.constEnd() ; ++ it) {
+		if (it.value().size() < 2) continue;
+		foreach(QString fichier, it.value()) sortie_standard << QString("%1").arg(it.key(), 16, 16, QChar('0')) << "  " << fichier << endl;
+	}
+	afficherDebit(fichiers.size(), nb_echecs, chrono.elapsed());
+	return(nb_echecs ? 1 : 0);
+}
+
+/**
+	Genere un schema synthetique pour les mesures de performances : une grille
+	d'elements, chacun relie a son voisin par un conducteur. Le type d'element
+	utilise est la premiere definition du dossier elements/ ayant au moins deux
+	bornes. Le routage automatique est desactive pendant la generation, les
+	conducteurs restent donc a recalculer.
+	@param schema Schema a remplir
+	@param nb_conducteurs Nombre de conducteurs a creer
+	@return true si la generation a reussi, false sinon
+*/
+static bool genererSchema(Schema &schema, int nb_conducteurs) {
+	QDir dossier("elements");
+	QString type;
+	const ElementDefinition *definition = 0;
+	foreach(QString fichier, dossier.entryList(QStringList() << "*.elmt", QDir::Files, QDir::Name)) {
+		const ElementDefinition *d = ElementDefinition::get(dossier.filePath(fichier));
+		if (d -> etat() || d -> bornes().size() < 2) continue;
+		type = fichier;
+		definition = d;
+		break;
+	}
+	if (!definition) return(false);
+	
+	bool routage = schema.autoRouting();
+	schema.setAutoRouting(false);
+	int pas_x = (definition -> largeur()  / GRILLE_X + 4) * GRILLE_X;
+	int pas_y = (definition -> hauteur() / GRILLE_Y + 4) * GRILLE_Y;
+	int colonnes = qMax(1, qRound(qSqrt(nb_conducteurs + 1.0)));
+	Terminal *precedente = 0;
+	for (int i = 0 ; i <= nb_conducteurs ; ++ i) {
+		ElementPerso *e = new ElementPerso(type);
+		e -> setFlags(QGraphicsItem::ItemIsMovable | QGraphicsItem::ItemIsSelectable | QGraphicsItem::ItemSendsGeometryChanges);
+		schema.addItem(e);
+		e -> setPos((i % colonnes) * pas_x, (i / colonnes) * pas_y);
+		QList<Terminal *> bornes;
+		foreach(QGraphicsItem *qgi, e -> childItems()) {
+			if (Terminal *t = qgraphicsitem_cast<Terminal *>(qgi)) bornes << t;
+		}
+		if (precedente) new Conductor(precedente, bornes.first(), 0, &schema);
+		precedente = bornes.last();
+	}
+	// les conducteurs sont marques a recalculer : le premier recalcul est laisse a la mesure
+	schema.setAutoRouting(routage);
+	return(true);
+}
+
+/**
+	Mesure "reroute" : recalcul de tous les conducteurs un par un sur le thread
+	principal, puis par Schema::rerouteAll(). Le routage automatique est active
+	pour la mesure.
+	@param schema Schema a mesurer
+	@param nb_threads Nombre de threads de rerouteAll (0 : un par coeur)
+*/
+static void benchReroute(Schema &schema, int nb_threads) {
+	schema.setAutoRouting(true);
+	QList<Conductor *> conducteurs;
+	foreach(QGraphicsItem *qgi, schema.items()) {
+		if (Conductor *c = qgraphicsitem_cast<Conductor *>(qgi)) conducteurs << c;
+	}
+	
+	QElapsedTimer chrono;
+	chrono.start();
+	foreach(Conductor *c, conducteurs) c -> markDirty();
+	schema.flushConductors();
+	qint64 sequentiel = chrono.nsecsElapsed();
+	QList<QPolygonF> trajets;
+	foreach(Conductor *c, conducteurs) trajets << c -> polyline();
+	
+	chrono.restart();
+	schema.rerouteAll(nb_threads);
+	qint64 parallele = chrono.nsecsElapsed();
+	int differences = 0;
+	for (int i = 0 ; i < conducteurs.size() ; ++ i) if (conducteurs.at(i) -> polyline() != trajets.at(i)) ++ differences;
+	
+	QTextStream out(stdout);
+	out << "conducteurs : " << conducteurs.size() << endl;
+	out << "sequentiel  : " << QString::number(sequentiel / 1e6, 'f', 1) << " ms" << endl;
+	out << "rerouteAll  : " << QString::number(parallele  / 1e6, 'f', 1) << " ms" << endl;
+	out << "acceleration : x" << QString::number(parallele ? double(sequentiel) / parallele : 0.0, 'f', 2) << endl;
+	// le budget du routeur est un nombre d'etats : les deux passes doivent donner les memes trajets
+	out << "trajets differents : " << differences << endl;
+}
+
+/**
+	Mesure "rubberband" : selection par rectangle sur une grille de 8 x 8 zones
+	couvrant le schema, comparee au test fonde sur le contour trace du chemin
+	qu'utilisait QGraphicsPathItem::shape().
+	@param schema Schema a mesurer
+*/
+static void benchRubberband(Schema &schema) {
+	schema.flushConductors();
+	QRectF etendue = schema.itemsBoundingRect();
+	QList<QPainterPath> zones;
+	for (int x = 0 ; x < 8 ; ++ x) {
+		for (int y = 0 ; y < 8 ; ++ y) {
+			QPainterPath zone;
+			zone.addRect(QRectF(
+				etendue.left() + x * etendue.width() / 8.0,
+				etendue.top()  + y * etendue.height() / 8.0,
+				etendue.width() / 8.0,
+				etendue.height() / 8.0
+			));
+			zones << zone;
+		}
+	}
+	
+	QElapsedTimer chrono;
+	chrono.start();
+	int selectionnes = 0;
+	foreach(QPainterPath zone, zones) {
+		schema.setSelectionArea(zone, Qt::IntersectsItemShape);
+		foreach(QGraphicsItem *qgi, schema.selectedItems()) if (qgi -> type() == Conductor::Type) ++ selectionnes;
+	}
+	qint64 zones_cachees = chrono.nsecsElapsed();
+	schema.clearSelection();
+	
+	chrono.restart();
+	int reference = 0;
+	foreach(QPainterPath zone, zones) {
+		foreach(QGraphicsItem *qgi, schema.items(zone.boundingRect(), Qt::IntersectsItemBoundingRect)) {
+			Conductor *c = qgraphicsitem_cast<Conductor *>(qgi);
+			if (!c) continue;
+			QPainterPathStroker contour;
+			contour.setWidth(c -> pen().widthF());
+			if (contour.createStroke(c -> path()).intersects(c -> mapFromScene(zone))) ++ reference;
+		}
+	}
+	qint64 contours = chrono.nsecsElapsed();
+	
+	QTextStream out(stdout);
+	out << "zones de selection : " << zones.size() << endl;
+	out << "contours traces : " << QString::number(contours / 1e6, 'f', 1) << " ms (" << reference << " conducteurs)" << endl;
+	out << "zones en cache  : " << QString::number(zones_cachees / 1e6, 'f', 1) << " ms (" << selectionnes << " conducteurs)" << endl;
+	out << "acceleration : x" << QString::number(zones_cachees ? double(contours) / zones_cachees : 0.0, 'f', 2) << endl;
+}
+
+/**
+	Mesure "move" : deplacement de tous les elements du schema, selectionnes,
+	sur 20 pas de souris. Le deplacement element par element (setPos de chaque
+	item selectionne, liste de la selection reconstruite a chaque pas) est
+	compare au deplacement groupe (GroupMove). Chaque pas se termine par le
+	recalcul des conducteurs et une interrogation de l'index de la scene,
+	comme avant un rendu.
+	@param schema Schema a mesurer
+*/
+static void benchMove(Schema &schema) {
+	const int nb_pas = 20;
+	schema.flushConductors();
+	int nb_elements = 0;
+	foreach(QGraphicsItem *qgi, schema.items()) {
+		if (Element *e = qgraphicsitem_cast<Element *>(qgi)) {
+			e -> setSelected(true);
+			++ nb_elements;
+		}
+	}
+	
+	QElapsedTimer chrono;
+	chrono.start();
+	for (int i = 0 ; i < nb_pas ; ++ i) {
+		foreach(QGraphicsItem *qgi, schema.selectedItems()) {
+			if (Element *e = qgraphicsitem_cast<Element *>(qgi)) e -> setPos(e -> pos() + QPointF(GRILLE_X, 0.0));
+		}
+		schema.flushConductors();
+		schema.items(schema.sceneRect());
+	}
+	qint64 element_par_element = chrono.nsecsElapsed();
+	
+	chrono.restart();
+	GroupMove *deplacement = schema.beginGroupMove();
+	qint64 debut = chrono.nsecsElapsed();
+	for (int i = 1 ; i <= nb_pas ; ++ i) {
+		deplacement -> moveBy(QPointF(i * GRILLE_X, 0.0));
+		schema.flushConductors();
+		schema.items(schema.sceneRect());
+	}
+	qint64 pas = chrono.nsecsElapsed() - debut;
+	chrono.restart();
+	schema.endGroupMove();
+	schema.flushConductors();
+	schema.items(schema.sceneRect());
+	qint64 fin = chrono.nsecsElapsed();
+	schema.clearSelection();
+	
+	QTextStream out(stdout);
+	out << "elements selectionnes : " << nb_elements << endl;
+	out << "  element par element : " << QString::number(element_par_element / 1e6 / nb_pas, 'f', 2) << " ms par pas" << endl;
+	out << "  deplacement groupe  : " << QString::number(pas / 1e6 / nb_pas, 'f', 2) << " ms par pas";
+	out << " (clic " << QString::number(debut / 1e6, 'f', 1) << " ms, relachement " << QString::number(fin / 1e6, 'f', 1) << " ms)" << endl;
+	out << "  acceleration : x" << QString::number(pas ? double(element_par_element) / pas : 0.0, 'f', 2) << endl;
+}
+
+/**
+	Mesure "hover" : 10 000 mouvements de souris sans bouton sur une grille
+	couvrant le schema. Le suivi de la borne survolee par le Schema est compare
+	a la distribution des evenements de survol par la scene, telle qu'elle
+	avait lieu lorsque chaque borne acceptait ces evenements.
+	@param schema Schema a mesurer
+*/
+static void benchHover(Schema &schema) {
+	schema.flushConductors();
+	QRectF etendue = schema.itemsBoundingRect();
+	QList<QPointF> points;
+	for (int x = 0 ; x < 100 ; ++ x) {
+		for (int y = 0 ; y < 100 ; ++ y) {
+			points << QPointF(etendue.left() + x * etendue.width() / 100.0, etendue.top() + y * etendue.height() / 100.0);
+		}
+	}
+	QList<Terminal *> bornes;
+	foreach(QGraphicsItem *qgi, schema.items()) {
+		if (Terminal *t = qgraphicsitem_cast<Terminal *>(qgi)) bornes << t;
+	}
+	
+	qint64 durees[2];
+	int survols[2];
+	for (int passe = 0 ; passe < 2 ; ++ passe) {
+		// seconde passe : les bornes acceptent de nouveau les evenements de
+		// survol, et le suivi du Schema est coupe pour ne mesurer que la scene
+		if (passe) {
+			foreach(Terminal *t, bornes) t -> setAcceptHoverEvents(true);
+			schema.setHoverTracking(false);
+		}
+		survols[passe] = 0;
+		QElapsedTimer chrono;
+		chrono.start();
+		foreach(QPointF point, points) {
+			QGraphicsSceneMouseEvent mouvement(QEvent::GraphicsSceneMouseMove);
+			mouvement.setScenePos(point);
+			mouvement.setButtons(Qt::NoButton);
+			QApplication::sendEvent(&schema, &mouvement);
+			if (schema.hoveredTerminal()) ++ survols[passe];
+		}
+		durees[passe] = chrono.nsecsElapsed();
+	}
+	foreach(Terminal *t, bornes) t -> setAcceptHoverEvents(false);
+	schema.setHoverTracking(true);
+	
+	QTextStream out(stdout);
+	out << "bornes : " << bornes.size() << ", mouvements : " << points.size() << endl;
+	out << "survol distribue par la scene : " << QString::number(durees[1] / 1e6, 'f', 1) << " ms" << endl;
+	out << "survol suivi par le Schema    : " << QString::number(durees[0] / 1e6, 'f', 1) << " ms (" << survols[0] << " bornes survolees)" << endl;
+	out << "acceleration : x" << QString::number(durees[0] ? double(durees[1]) / durees[0] : 0.0, 'f', 2) << endl;
+}
+
+/**
+	Mesure "select" : tout selectionner, inverser la selection puis tout
+	deselectionner, item par item (comme le faisait SchemaView) puis par la
+	selection en masse du Schema. Chaque operation est suivie du traitement des
+	evenements en attente, ou sont faits les rafraichissements et l'emission
+	de selectionChanged().
+	@param schema Schema a mesurer
+*/
+static void benchSelect(Schema &schema) {
+	schema.flushConductors();
+	QCoreApplication::processEvents();
+	QElapsedTimer chrono;
+	chrono.start();
+	foreach(QGraphicsItem *qgi, schema.items()) qgi -> setSelected(true);
+	QCoreApplication::processEvents();
+	foreach(QGraphicsItem *qgi, schema.items()) qgi -> setSelected(!qgi -> isSelected());
+	QCoreApplication::processEvents();
+	foreach(QGraphicsItem *qgi, schema.items()) qgi -> setSelected(false);
+	QCoreApplication::processEvents();
+	qint64 item_par_item = chrono.nsecsElapsed();
+	
+	chrono.restart();
+	schema.selectAllElements();
+	QCoreApplication::processEvents();
+	schema.invertSelection();
+	QCoreApplication::processEvents();
+	schema.clearElementSelection();
+	QCoreApplication::processEvents();
+	qint64 en_masse = chrono.nsecsElapsed();
+	
+	QTextStream out(stdout);
+	int nb_elements = 0;
+	foreach(int n, schema.elementTypeCounts()) nb_elements += n;
+	out << "elements : " << nb_elements << ", items : " << schema.items().size() << endl;
+	out << "item par item : " << QString::number(item_par_item / 1e6, 'f', 1) << " ms" << endl;
+	out << "en masse      : " << QString::number(en_masse / 1e6, 'f', 1) << " ms" << endl;
+	out << "acceleration : x" << QString::number(en_masse ? double(item_par_item) / en_masse : 0.0, 'f', 2) << endl;
+}
+
+/**
+	Mesure "delete" : suppression de tous les elements du schema, avec leurs
+	conducteurs, comme le fait SchemaView : retrait de la scene, puis
+	destruction par tranches dans la boucle d'evenements. La plus longue
+	tranche donne le temps maximal pendant lequel l'interface serait bloquee.
+	@param schema Schema a mesurer
+*/
+static void benchDelete(Schema &schema) {
+	schema.flushConductors();
+	int nb_items = schema.items().size();
+	DestructionQueue corbeille;
+	QElapsedTimer chrono;
+	chrono.start();
+	schema.selectAllElements();
+	QList<Element *> elements = schema.selectedElements();
+	schema.clearElementSelection();
+	corbeille.add(schema.detachElements(elements));
+	qint64 retrait = chrono.nsecsElapsed();
+	
+	chrono.restart();
+	QElapsedTimer tranche;
+	qint64 plus_longue = 0;
+	int nb_tranches = 0;
+	while (corbeille.size()) {
+		tranche.start();
+		QCoreApplication::processEvents();
+		plus_longue = qMax(plus_longue, tranche.nsecsElapsed());
+		++ nb_tranches;
+	}
+	qint64 destruction = chrono.nsecsElapsed();
+	
+	QTextStream out(stdout);
+	out << "items supprimes : " << nb_items - schema.items().size() << " (" << elements.size() << " elements)" << endl;
+	out << "retrait de la scene : " << QString::number(retrait / 1e6, 'f', 1) << " ms" << endl;
+	out << "destruction : " << QString::number(destruction / 1e6, 'f', 1) << " ms en " << nb_tranches << " tranches (plus longue : " << QString::number(plus_longue / 1e6, 'f', 1) << " ms)" << endl;
+}
+
+/**
+	Commande "bench" : mesures de performances sur des schemas charges ou generes
+	@param args Arguments de la commande (le premier est le nom du programme)
+	@return Le code de retour du programme
+*/
+static int commandeBench(const QStringList &args) {
+	QCommandLineParser parseur;
+	parseur.addHelpOption();
+	QCommandLineOption option_conducteurs(QStringList() << "n" << "conductors", "Nombre de conducteurs du schema genere (sans fichier).", "n", "10000");
+	QCommandLineOption option_jobs(QStringList() << "j" << "jobs", "Nombre de threads (par defaut : un par coeur).", "n", "0");
+	parseur.addOption(option_conducteurs);
+	parseur.addOption(option_jobs);
+	parseur.addPositionalArgument("mesure", "reroute, rubberband, move, hover, select ou delete");
+	parseur.addPositionalArgument("fichier", "Schema *.qet a mesurer ; a defaut, un schema est genere.", "[fichier.qet]");
+	parseur.process(args);
+	
+	QStringList positionnels = parseur.positionalArguments();
+	if (positionnels.isEmpty()) parseur.showHelp(2);
+	QString mesure = positionnels.takeFirst();
+	if (mesure != "reroute" && mesure != "rubberband" && mesure != "move" && mesure != "hover" && mesure != "select" && mesure != "delete") {
+		sortieErreur() << "Mesure inconnue : " << mesure << endl;
+		return(2);
+	}
+	
+	// sans fichier ni taille imposee, le deplacement est mesure sur 1 000, 5 000 et 20 000 elements
+	if (mesure == "move" && positionnels.isEmpty() && !parseur.isSet(option_conducteurs)) {
+		foreach(int nb_elements, QList<int>() << 1000 << 5000 << 20000) {
+			Schema schema;
+			if (!genererSchema(schema, nb_elements - 1)) {
+				sortieErreur() << "Aucune definition d'element a deux bornes dans le dossier elements/" << endl;
+				return(1);
+			}
+			benchMove(schema);
+		}
+		return(0);
+	}
+	
+	Schema schema;
+	if (!positionnels.isEmpty()) {
+		int erreur;
+		if (!schema.fromFile(positionnels.first(), &erreur)) {
+			sortieErreur() << positionnels.first() << " : chargement impossible (erreur " << erreur << ")" << endl;
+			return(1);
+		}
+	} else if (mesure == "select" && !parseur.isSet(option_conducteurs)) {
+		// sans taille imposee, la selection est mesuree sur 100 000 elements
+		if (!genererSchema(schema, 99999)) {
+			sortieErreur() << "Aucune definition d'element a deux bornes dans le dossier elements/" << endl;
+			return(1);
+		}
+	} else if (!genererSchema(schema, parseur.value(option_conducteurs).toInt())) {
+		sortieErreur() << "Aucune definition d'element a deux bornes dans le dossier elements/" << endl;
+		return(1);
+	}
+	if (mesure == "rubberband") benchRubberband(schema);
+	else if (mesure == "move") benchMove(schema);
+	else if (mesure == "hover") benchHover(schema);
+	else if (mesure == "select") benchSelect(schema);
+	else if (mesure == "delete") benchDelete(schema);
+	else benchReroute(schema, parseur.value(option_jobs).toInt());
+	return(0);
+}
+
+/**
+	Affiche l'aide generale de l'outil
+	@return Le code de retour du programme
+*/
+static int aide() {
+	sortieErreur() << "Usage : qet-cli <commande> [options] [fichiers]" << endl;
+	sortieErreur() << "Commandes :" << endl;
+	sortieErreur() << "  export   exporte des schemas en png, svg ou pdf" << endl;
+	sortieErreur() << "  convert  reenregistre des schemas au format qet" << endl;
+	sortieErreur() << "  batch    valide, exporte ou convertit des arborescences de schemas en parallele" << endl;
+	sortieErreur() << "  netlist  ecrit la netlist des schemas (spice ou csv)" << endl;
+	sortieErreur() << "  bom      ecrit la nomenclature des schemas (csv ou html)" << endl;
+	sortieErreur() << "  diff     liste les differences structurelles entre deux revisions d'un schema" << endl;
+	sortieErreur() << "  merge    fusionne deux revisions d'un schema issues d'une revision commune" << endl;
+	sortieErreur() << "  hash     ecrit l'empreinte canonique du contenu des schemas" << endl;
+	sortieErreur() << "  bench    mesures de performances (reroute, rubberband, move, hover, select, delete)" << endl;
+	sortieErreur() << "Les definitions d'elements sont cherchees dans le dossier elements/ du dossier courant." << endl;
+	return(2);
+}
+
+/**
+	Fonction principale de l'outil en ligne de commande de QElectroTech
+	@param argc nombre de parametres
+	@param argv parametres
+*/
+int main(int argc, char **argv) {
+	// pas d'affichage : la plateforme offscreen suffit au rendu des schemas
+	if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+
+	// Schema est une QGraphicsScene : une QApplication est necessaire
+	QApplication app(argc, argv);
+	QApplication::setApplicationName("qet-cli");
+
+	QStringList args = app.arguments();
+	if (args.size() < 2) return(aide());
+
+	// la commande est retiree des arguments transmis a son parseur
+	QString commande = args.takeAt(1);
+	if (commande == "export")  return(commandeExport(args, false));
+	if (commande == "convert") return(commandeExport(args, true));
+	if (commande == "batch")   return(commandeBatch(args));
+	if (commande == "netlist") return(commandeNetlist(args));
+	if (commande == "bom")     return(commandeBom(args));
+	if (commande == "diff")    return(commandeDiff(args));
+	if (commande == "merge")   return(commandeMerge(args));
+	if (commande == "hash")    return(commandeHash(args));
+	if (commande == "bench")   return(commandeBench(args));
+	return(aide());
+}
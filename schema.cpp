@@ -1,14 +1,22 @@
 #include <math.h>
 #include "conductor.h"
+#include "conductorbundle.h"
 #include "contactor.h"
 #include "elementperso.h"
 #include "schema.h"
+#include "paintstats.h"
+#include "groupmove.h"
+
+/// nombre d'items supprimes a partir duquel l'index de la scene peut etre suspendu
+#define SEUIL_INDEX_SUPPRESSION 200
+/// part de la scene (1 / FRACTION_INDEX_SUPPRESSION) a supprimer pour suspendre son index
+#define FRACTION_INDEX_SUPPRESSION 4
 
 /**
 	Constructeur
 	@param parent Le QObject parent du schema
 */
-Schema::Schema(QObject *parent) : QGraphicsScene(parent) {
+Schema::Schema(QObject *parent) : QGraphicsScene(parent), terminal_index(2.0 * RAYON_AIMANTATION), routeur(element_index) {
 	setBackgroundBrush(Qt::white);
 	poseur_de_conducteur = new QGraphicsLineItem();
 	poseur_de_conducteur -> setZValue(1000000);
@@ -19,7 +27,14 @@ Schema::Schema(QObject *parent) : QGraphicsScene(parent) {
 	poseur_de_conducteur -> setPen(t);
 	poseur_de_conducteur -> setLine(QLineF(QPointF(0.0, 0.0), QPointF(0.0, 0.0)));
 	doit_dessiner_grille = true;
-	connect(this, SIGNAL(changed(const QList<QRectF> &)), this, SLOT(slot_checkSelectionChange()));
+	conductor_layer = false;
+	recalcul_planifie = false;
+	auto_routage = false;
+	deplacement_groupe = 0;
+	borne_survolee = 0;
+	suivi_survol = true;
+	signal_selection_planifie = false;
+	selection_groupee = 0;
 }
 
 /**
@@ -61,17 +76,759 @@ void Schema::drawBackground(QPainter *p, const QRectF &r) {
 		p -> drawLine(0, 0, 0, 10);
 		p -> drawLine(0, 0, 10, 0);
 	}
+	
+	// les conducteurs sont dessines avec la grille, sous les elements
+	if (conductor_layer) drawConductorLayer(p, r);
 	p -> restore();
 }
 
-QImage Schema::toImage() {
+/**
+	Dessine en une seule passe tous les conducteurs visibles dans une zone : un
+	seul stylo et un seul jeu de renderhints pour tous les conducteurs, qui sont
+	retrouves via l'index spatial plutot que par le BSP de la scene.
+	Le QPainter doit deja etre configure sans antialiasing.
+	@param p Le QPainter a utiliser pour dessiner
+	@param r Le rectangle de la zone a dessiner
+*/
+void Schema::drawConductorLayer(QPainter *p, const QRectF &r) {
+	QPen t;
+	t.setColor(Qt::black);
+	t.setWidthF(1.0);
+	p -> setPen(t);
+	p -> setBrush(Qt::NoBrush);
+	foreach(Conductor *c, conductor_index.query(r)) {
+		// les conducteurs n'ont pas de parent : leur chemin est en coordonnees de la scene
+		PAINTSTATS_COUNT(conductors);
+		p -> drawPath(c -> path().translated(c -> pos()));
+	}
+}
+
+/**
+	Dessine le premier plan du schema, cad la surcouche de selection.
+	@param p Le QPainter a utiliser pour dessiner
+	@param r Le rectangle de la zone a dessiner
+*/
+void Schema::drawForeground(QPainter *p, const QRectF &r) {
+	if (elements_selectionnes.isEmpty()) return;
+	p -> save();
+	p -> setRenderHint(QPainter::Antialiasing,          false);
+	p -> setRenderHint(QPainter::TextAntialiasing,      false);
+	p -> setRenderHint(QPainter::SmoothPixmapTransform, false);
+	drawSelectionOverlay(p, r);
+	p -> restore();
+}
+
+/**
+	Dessine en une seule passe les cadres de selection de tous les elements
+	selectionnes visibles dans une zone. A faible zoom, les cadres sont remplaces
+	par une zone grossiere couvrant les cellules occupees par la selection.
+	@param p Le QPainter a utiliser pour dessiner
+	@param r Le rectangle de la zone a dessiner
+*/
+void Schema::drawSelectionOverlay(QPainter *p, const QRectF &r) {
+	qreal zoom = qSqrt(qAbs(p -> worldTransform().determinant()));
+	QPainterPath chemin;
+	
+	if (zoom >= ZOOM_SELECTION_GROSSIERE) {
+		// tous les cadres de selection dans un seul chemin
+		foreach(Element *elmt, elements_selectionnes) {
+			QRectF br = elmt -> sceneBoundingRect();
+			if (br.intersects(r)) chemin.addRoundedRect(br, 10, 10, Qt::RelativeSize);
+		}
+		QPen t;
+		t.setColor(Qt::gray);
+		t.setStyle(Qt::DashDotLine);
+		p -> setPen(t);
+		p -> setBrush(Qt::NoBrush);
+		p -> drawPath(chemin);
+		return;
+	}
+	
+	// zone grossiere : reunion des cellules touchees par la selection
+	QSet<quint64> cellules;
+	foreach(Element *elmt, elements_selectionnes) {
+		QRectF br = elmt -> sceneBoundingRect();
+		if (!br.intersects(r)) continue;
+		int x2 = qFloor(br.right()  / CELLULE_SELECTION);
+		int y2 = qFloor(br.bottom() / CELLULE_SELECTION);
+		for (int x = qFloor(br.left() / CELLULE_SELECTION) ; x <= x2 ; ++ x) {
+			for (int y = qFloor(br.top() / CELLULE_SELECTION) ; y <= y2 ; ++ y) {
+				quint64 cle = (quint64(quint32(x)) << 32) | quint32(y);
+				if (cellules.contains(cle)) continue;
+				cellules.insert(cle);
+				chemin.addRect(x * CELLULE_SELECTION, y * CELLULE_SELECTION, CELLULE_SELECTION, CELLULE_SELECTION);
+			}
+		}
+	}
+	p -> setPen(Qt::gray);
+	p -> setBrush(QColor(128, 128, 128, 64));
+	p -> drawPath(chemin.simplified());
+}
+
+/**
+	Tient a jour la liste des elements selectionnes du schema. Le signal
+	selectionChanged() est emis une seule fois pour tous les changements faits
+	avant le retour a la boucle d'evenements.
+	@param elmt L'element dont l'etat de selection a change
+	@param selectionne true si l'element est desormais selectionne
+*/
+void Schema::elementSelectionChanged(Element *elmt, bool selectionne) {
+	if (selectionne) {
+		if (elements_selectionnes.contains(elmt)) return;
+		elements_selectionnes.insert(elmt);
+	} else if (!elements_selectionnes.remove(elmt)) return;
+	// pendant une selection en masse, la zone est rafraichie une seule fois a la fin
+	if (selection_groupee) {
+		zone_selection_groupee |= elmt -> sceneBoundingRect();
+		return;
+	}
+	invalidateSelection(elmt -> sceneBoundingRect());
+	if (signal_selection_planifie) return;
+	signal_selection_planifie = true;
+	QMetaObject::invokeMethod(this, "emitSelectionChanged", Qt::QueuedConnection);
+}
+
+/**
+	Commence une selection en masse : les changements de selection ne
+	rafraichissent plus la surcouche de selection et ne planifient plus
+	l'emission de selectionChanged() jusqu'a l'appel de endBulkSelection()
+*/
+void Schema::beginBulkSelection() {
+	++ selection_groupee;
+}
+
+/**
+	Termine une selection en masse : la zone dont la selection a change est
+	rafraichie en une fois et selectionChanged() est emis une fois
+*/
+void Schema::endBulkSelection() {
+	if (-- selection_groupee || zone_selection_groupee.isNull()) return;
+	invalidateSelection(zone_selection_groupee);
+	zone_selection_groupee = QRectF();
+	if (signal_selection_planifie) return;
+	signal_selection_planifie = true;
+	QMetaObject::invokeMethod(this, "emitSelectionChanged", Qt::QueuedConnection);
+}
+
+/**
+	Selectionne ou deselectionne des elements en une seule operation
+	@param elements Les elements concernes
+	@param selectionne true pour les selectionner, false pour les deselectionner
+*/
+void Schema::setElementsSelected(const QList<Element *> &elements, bool selectionne) {
+	beginBulkSelection();
+	foreach(Element *e, elements) e -> setSelected(selectionne);
+	endBulkSelection();
+}
+
+/**
+	Selectionne tous les elements du schema ; ils sont pris dans l'index des
+	elements plutot que dans la liste triee des items de la scene
+*/
+void Schema::selectAllElements() {
+	setElementsSelected(element_index.items(), true);
+}
+
+/**
+	Deselectionne tous les elements selectionnes
+*/
+void Schema::clearElementSelection() {
+	setElementsSelected(selectedElements(), false);
+}
+
+/**
+	Inverse l'etat de selection de tous les elements du schema
+*/
+void Schema::invertSelection() {
+	beginBulkSelection();
+	QSet<Element *> anciens = elements_selectionnes;
+	foreach(Element *e, element_index.items()) e -> setSelected(!anciens.contains(e));
+	endBulkSelection();
+}
+
+/**
+	Emet le signal selectionChanged() planifie par elementSelectionChanged()
+*/
+void Schema::emitSelectionChanged() {
+	signal_selection_planifie = false;
+	emit(selectionChanged());
+}
+
+/**
+	Commence le deplacement groupe des items selectionnes ; appele au clic sur
+	un element. Un deplacement deja commence est conserve.
+	@return Le deplacement en cours
+*/
+GroupMove *Schema::beginGroupMove() {
+	if (!deplacement_groupe) deplacement_groupe = new GroupMove(this, selectedItems());
+	return(deplacement_groupe);
+}
+
+/**
+	Termine le deplacement groupe en cours, s'il y en a un ; appele au
+	relachement de la souris
+*/
+void Schema::endGroupMove() {
+	if (!deplacement_groupe) return;
+	deplacement_groupe -> finish();
+	delete deplacement_groupe;
+	deplacement_groupe = 0;
+}
+
+/**
+	Demande le rafraichissement de la surcouche de selection sur une zone,
+	etendue aux cellules de la zone grossiere de selection
+	@param r La zone dont la selection a change
+*/
+void Schema::invalidateSelection(const QRectF &r) {
+	qreal x1 = qFloor(r.left() / CELLULE_SELECTION) * CELLULE_SELECTION;
+	qreal y1 = qFloor(r.top()  / CELLULE_SELECTION) * CELLULE_SELECTION;
+	qreal x2 = (qFloor(r.right()  / CELLULE_SELECTION) + 1) * CELLULE_SELECTION;
+	qreal y2 = (qFloor(r.bottom() / CELLULE_SELECTION) + 1) * CELLULE_SELECTION;
+	update(QRectF(QPointF(x1, y1), QPointF(x2, y2)));
+}
+
+/**
+	Active ou desactive le rendu des conducteurs en une seule passe. Lorsqu'il est
+	actif, les conducteurs restent des items de la scene (selectionnables, detectables
+	sous le curseur) mais ne se dessinent plus eux-memes.
+	@param couche true pour dessiner les conducteurs en une seule passe
+*/
+void Schema::setConductorLayer(bool couche) {
+	if (couche == conductor_layer) return;
+	conductor_layer = couche;
+	foreach(Conductor *c, conductor_index.items()) c -> setFlag(QGraphicsItem::ItemHasNoContents, couche);
+	update();
+}
+
+/**
+	Met a jour l'index spatial des conducteurs apres une modification du trace
+	d'un conducteur
+	@param c Le conducteur modifie
+*/
+void Schema::conductorGeometryChanged(Conductor *c) {
+	indexConductor(c);
+	// les croisements sont recherches apres le recalcul des conducteurs
+	croisements_a_recalculer.insert(c);
+	if (recalcul_planifie) return;
+	recalcul_planifie = true;
+	QMetaObject::invokeMethod(this, "flushConductors", Qt::QueuedConnection);
+}
+
+/**
+	Reference un conducteur dans l'index spatial, ou y met a jour son rectangle
+	@param c Le conducteur a indexer
+*/
+void Schema::indexConductor(Conductor *c) {
+	QRectF nouveau = c -> sceneBoundingRect();
+	if (conductor_index.contains(c)) {
+		QRectF ancien = conductor_index.rect(c);
+		conductor_index.update(c, nouveau);
+		// un item sans contenu n'invalide pas lui-meme la zone qu'il occupe
+		if (conductor_layer) update(ancien.united(nouveau));
+		emit(contentChanged(ancien.united(nouveau)));
+	} else {
+		conductor_index.insert(c, nouveau);
+		c -> setFlag(QGraphicsItem::ItemHasNoContents, conductor_layer);
+		if (conductor_layer) update(nouveau);
+		emit(contentChanged(nouveau));
+	}
+}
+
+/**
+	Retire un conducteur de l'index spatial des conducteurs et des reseaux
+	@param c Le conducteur retire du schema
+*/
+void Schema::conductorRemoved(Conductor *c) {
+	reseaux.disconnect(c -> terminal1, c -> terminal2);
+	empreinte.linkRemoved(c -> terminal1, c -> terminal2);
+	emit(connectivityChanged(c -> terminal1));
+	emit(connectivityChanged(c -> terminal2));
+	conducteurs_a_recalculer.remove(c);
+	croisements_a_recalculer.remove(c);
+	// les conducteurs qu'il croisait perdent leurs sauts
+	foreach(Conductor *v, croisements.remove(c)) {
+		v -> setJumps(croisements.jumps(v));
+		indexConductor(v);
+	}
+	if (!conductor_index.contains(c)) return;
+	if (conductor_layer) update(conductor_index.rect(c));
+	emit(contentChanged(conductor_index.rect(c)));
+	conductor_index.remove(c);
+}
+
+/**
+	Demande le recalcul du trace d'un conducteur. Les demandes sont
+	regroupees : une seule passe de recalcul est planifiee, avant le prochain
+	rendu, et chaque conducteur n'y est recalcule qu'une fois.
+	@param c Le conducteur a recalculer
+*/
+void Schema::markConductorDirty(Conductor *c) {
+	PAINTSTATS_COUNT(demandes);
+	conducteurs_a_recalculer.insert(c);
+	if (recalcul_planifie) return;
+	recalcul_planifie = true;
+	QMetaObject::invokeMethod(this, "flushConductors", Qt::QueuedConnection);
+}
+
+/**
+	Recalcule le trace de tous les conducteurs en attente
+*/
+void Schema::flushConductors() {
+	// les conducteurs recalcules pendant la passe ne planifient pas de nouvelle passe
+	recalcul_planifie = true;
+	if (!faisceaux_a_recalculer.isEmpty()) {
+		QSet<ConductorBundle *> faisceaux;
+		faisceaux.swap(faisceaux_a_recalculer);
+		foreach(ConductorBundle *f, faisceaux) {
+			if (!f -> isDestroyed()) f -> recalculate();
+		}
+	}
+	if (!conducteurs_a_recalculer.isEmpty()) {
+		QSet<Conductor *> a_recalculer;
+		a_recalculer.swap(conducteurs_a_recalculer);
+		foreach(Conductor *c, a_recalculer) {
+			if (!c -> isDestroyed()) c -> recalculate();
+		}
+	}
+	updateCrossings();
+	recalcul_planifie = false;
+	if (!conducteurs_a_recalculer.isEmpty() || !faisceaux_a_recalculer.isEmpty()) {
+		recalcul_planifie = true;
+		QMetaObject::invokeMethod(this, "flushConductors", Qt::QueuedConnection);
+	}
+}
+
+/**
+	Recherche les croisements des conducteurs dont le trace a change, puis met a
+	jour les sauts de tous les conducteurs concernes. Seuls les conducteurs
+	modifies et leurs voisins sont balayes.
+*/
+void Schema::updateCrossings() {
+	if (croisements_a_recalculer.isEmpty()) return;
+	QSet<Conductor *> modifies;
+	modifies.swap(croisements_a_recalculer);
+	foreach(Conductor *c, croisements.update(modifies, conductor_index)) {
+		c -> setJumps(croisements.jumps(c));
+		// le rectangle englobant inclut les arcs des sauts
+		indexConductor(c);
+	}
+}
+
+/**
+	Demande le recalcul d'un faisceau, lors de la meme passe que les conducteurs
+	@param f Le faisceau a recalculer
+*/
+void Schema::markBundleDirty(ConductorBundle *f) {
+	PAINTSTATS_COUNT(demandes);
+	faisceaux_a_recalculer.insert(f);
+	if (recalcul_planifie) return;
+	recalcul_planifie = true;
+	QMetaObject::invokeMethod(this, "flushConductors", Qt::QueuedConnection);
+}
+
+/**
+	Oublie un faisceau retire du schema
+	@param f Le faisceau retire
+*/
+void Schema::bundleRemoved(ConductorBundle *f) {
+	faisceaux_a_recalculer.remove(f);
+	for (int i = 0 ; i < f -> size() ; ++ i) {
+		reseaux.disconnect(f -> terminals1().at(i), f -> terminals2().at(i));
+		empreinte.linkRemoved(f -> terminals1().at(i), f -> terminals2().at(i), true);
+		emit(connectivityChanged(f -> terminals1().at(i)));
+		emit(connectivityChanged(f -> terminals2().at(i)));
+	}
+	emit(contentChanged(f -> sceneBoundingRect()));
+}
+
+/**
+	Enregistre les liaisons d'un faisceau ajoute au schema
+	@param f Le faisceau ajoute
+*/
+void Schema::bundleAdded(ConductorBundle *f) {
+	for (int i = 0 ; i < f -> size() ; ++ i) {
+		reseaux.connect(f -> terminals1().at(i), f -> terminals2().at(i));
+		empreinte.linkAdded(f -> terminals1().at(i), f -> terminals2().at(i), true);
+		emit(connectivityChanged(f -> terminals1().at(i)));
+	}
+}
+
+/**
+	Enregistre la liaison etablie par un conducteur ajoute au schema
+	@param c Le conducteur ajoute
+*/
+void Schema::conductorAdded(Conductor *c) {
+	reseaux.connect(c -> terminal1, c -> terminal2);
+	empreinte.linkAdded(c -> terminal1, c -> terminal2);
+	emit(connectivityChanged(c -> terminal1));
+}
+
+/**
+	Remplace tous les conducteurs reliant deux elements par un faisceau. Les
+	bornes deja engagees dans un faisceau ne sont pas concernees.
+	@param a Premier element
+	@param b Second element
+	@return Le faisceau cree, ou 0 s'il y avait moins de deux conducteurs a regrouper
+*/
+ConductorBundle *Schema::bundleConductors(Element *a, Element *b) {
+	QList<Terminal *> b1, b2;
+	QList<Conductor *> conducteurs;
+	foreach(QGraphicsItem *qgi, a -> childItems()) {
+		Terminal *p = qgraphicsitem_cast<Terminal *>(qgi);
+		if (!p || p -> bundle()) continue;
+		foreach(Conductor *c, p -> conducteurs()) {
+			Terminal *autre = (c -> terminal1 == p) ? c -> terminal2 : c -> terminal1;
+			if (autre -> parentItem() != b || autre -> bundle() || b2.contains(autre)) continue;
+			b1 << p;
+			b2 << autre;
+			conducteurs << c;
+			break;
+		}
+	}
+	if (conducteurs.size() < 2) return(0);
+	foreach(Conductor *c, conducteurs) {
+		c -> destroy();
+		removeItem(c);
+		delete c;
+	}
+	return(new ConductorBundle(b1, b2, this));
+}
+
+/**
+	Active ou desactive le routage automatique ; tous les conducteurs sont
+	alors recalcules.
+	@param routage true pour que les conducteurs evitent les elements, false
+	pour revenir aux formes fixes
+*/
+void Schema::setAutoRouting(bool routage) {
+	if (routage == auto_routage) return;
+	auto_routage = routage;
+	foreach(Conductor *c, conductor_index.items()) c -> markDirty();
+}
+
+/**
+	Cherche un trajet evitant les elements du schema
+	@param p1 Point d'amarrage de la premiere borne, en coordonnees de la scene
+	@param o1 Orientation de la premiere borne
+	@param p2 Point d'amarrage de la seconde borne, en coordonnees de la scene
+	@param o2 Orientation de la seconde borne
+	@return Les sommets du trajet, ou un trajet vide si aucun trajet n'a ete trouve dans le budget du routeur
+*/
+QPolygonF Schema::routeConductor(const QPointF &p1, Terminal::Orientation o1, const QPointF &p2, Terminal::Orientation o2) const {
+	return(routeur.route(p1, o1, p2, o2));
+}
+
+/**
+	Met a jour l'index spatial des elements apres un deplacement ou une
+	rotation. Seuls les conducteurs dont le trajet passait par l'ancienne
+	position de l'element ou traverse sa nouvelle position sont reroutes.
+	@param e L'element deplace
+*/
+void Schema::elementGeometryChanged(Element *e) {
+	empreinte.elementChanged(e);
+	QRectF nouveau = e -> sceneBoundingRect();
+	bool connu = element_index.contains(e);
+	QRectF ancien = element_index.rect(e);
+	// une rotation peut deplacer les bornes sans changer le rectangle de l'element
+	indexTerminals(e, true);
+	if (connu && ancien == nouveau) return;
+	element_index.update(e, nouveau);
+	if (!connu) ++ comptes_types[QFileInfo(e -> typeId()).fileName()];
+	emit(contentChanged(connu ? ancien.united(nouveau) : nouveau));
+	if (!auto_routage) return;
+	
+	QSet<Conductor *> a_rerouter;
+	// l'element libere sa place : les conducteurs qui le contournaient peuvent raccourcir
+	if (connu) foreach(Conductor *c, conductor_index.query(ancien)) a_rerouter << c;
+	// l'element occupe une nouvelle place : les conducteurs qui la traversent doivent l'eviter
+	foreach(Conductor *c, conductor_index.query(nouveau)) if (c -> traverse(nouveau)) a_rerouter << c;
+	foreach(Conductor *c, a_rerouter) c -> markDirty();
+}
+
+/**
+	Recalcule le trajet de tous les conducteurs du schema. Les extremites des
+	conducteurs et les obstacles sont photographies, les trajets sont calcules
+	en parallele sans toucher aux items, puis appliques en une seule passe
+	pendant laquelle l'index de la scene est suspendu.
+	@param nb_threads Nombre de threads, 0 pour un thread par coeur
+	@return Le nombre de conducteurs reroutes
+*/
+int Schema::rerouteAll(int nb_threads) {
+	QList<Conductor *> conducteurs = conductor_index.items();
+	QVector<ConductorRouter::Requete> requetes;
+	requetes.reserve(conducteurs.size());
+	foreach(Conductor *c, conducteurs) {
+		ConductorRouter::Requete q;
+		q.p1 = c -> terminal1 -> amarrageConducteur();
+		q.o1 = c -> terminal1 -> orientation();
+		q.p2 = c -> terminal2 -> amarrageConducteur();
+		q.o2 = c -> terminal2 -> orientation();
+		requetes << q;
+	}
+	
+	// les threads travaillent sur une copie de l'index des elements
+	SpatialIndex<Element *> obstacles(element_index);
+	ConductorRouter routeur_instantane(obstacles);
+	routeur_instantane.setExpansionBudget(routeur.expansionBudget());
+	QVector<QPolygonF> trajets = routeur_instantane.routeAll(requetes, auto_routage, nb_threads);
 	
+	// application groupee : l'index de la scene n'est reconstruit qu'une fois
+	ItemIndexMethod methode = itemIndexMethod();
+	if (methode != NoIndex) setItemIndexMethod(NoIndex);
+	for (int i = 0 ; i < conducteurs.size() ; ++ i) {
+		conducteurs_a_recalculer.remove(conducteurs.at(i));
+		conducteurs.at(i) -> setPolyline(trajets.at(i));
+	}
+	if (methode != NoIndex) setItemIndexMethod(methode);
+	return(conducteurs.size());
+}
+
+/**
+	@param trajet Sommets d'un trajet, en coordonnees de la scene
+	@param c Conducteur suivant le trajet, ou 0. Les elements portant ses
+	bornes sont ignores : les points d'amarrage sont a l'interieur de leur
+	element, et un trajet translate avec ses deux extremites garde la meme
+	position par rapport a elles.
+	@return true si aucun segment du trajet ne touche un autre element du schema
+*/
+bool Schema::pathIsClear(const QPolygonF &trajet, const Conductor *c) const {
+	const QGraphicsItem *bout1 = c ? c -> terminal1 -> parentItem() : 0;
+	const QGraphicsItem *bout2 = c ? c -> terminal2 -> parentItem() : 0;
+	for (int i = 1 ; i < trajet.size() ; ++ i) {
+		foreach(Element *e, element_index.query(QRectF(trajet.at(i - 1), trajet.at(i)).normalized())) {
+			if (e != bout1 && e != bout2) return(false);
+		}
+	}
+	return(true);
+}
+
+/**
+	Reference les points d'amarrage des bornes d'un element, ou les retire de
+	l'index des bornes
+	@param e L'element
+	@param present true si l'element est sur le schema, false s'il le quitte
+*/
+void Schema::indexTerminals(Element *e, bool present) {
+	foreach(QGraphicsItem *qgi, e -> childItems()) {
+		Terminal *t = qgraphicsitem_cast<Terminal *>(qgi);
+		if (!t) continue;
+		if (present) terminal_index.insert(t, QRectF(t -> amarrageConducteur(), QSizeF(0.0, 0.0)));
+		else terminal_index.remove(t);
+	}
+}
+
+/**
+	@param p Un point, en coordonnees de la scene
+	@return La borne sous le point, ou 0 ; si plusieurs bornes se chevauchent,
+	celle dont le point d'amarrage est le plus proche
+*/
+Terminal *Schema::terminalAt(const QPointF &p) const {
+	// le rectangle d'une borne s'etend a TAILLE_BORNE + 3 de son point d'amarrage
+	qreal portee = TAILLE_BORNE + 3.0;
+	Terminal *resultat = 0;
+	qreal distance_min = 0.0;
+	foreach(Terminal *t, terminal_index.query(QRectF(p - QPointF(portee, portee), QSizeF(2 * portee, 2 * portee)))) {
+		if (!t -> sceneBoundingRect().contains(p)) continue;
+		QPointF d = terminal_index.rect(t).topLeft() - p;
+		qreal distance = d.x() * d.x() + d.y() * d.y();
+		if (!resultat || distance < distance_min) {
+			distance_min = distance;
+			resultat = t;
+		}
+	}
+	return(resultat);
+}
+
+/**
+	Recherche la borne libre (sans conducteur ni faisceau) la plus proche d'un
+	point. Seules les cellules de l'index des bornes couvrant le rayon sont
+	parcourues : le cout ne depend pas de la taille du schema.
+	@param p Un point, en coordonnees de la scene
+	@param rayon Distance maximale entre le point et le point d'amarrage de la borne
+	@param depart Borne de depart d'un conducteur : elle est exclue, ainsi que les
+	bornes de son element si celui-ci n'accepte pas les connexions internes
+	@return La borne trouvee, ou 0
+*/
+Terminal *Schema::nearestFreeTerminal(const QPointF &p, qreal rayon, Terminal *depart) const {
+	Element *exclu = 0;
+	if (depart) {
+		Element *elmt = qgraphicsitem_cast<Element *>(depart -> parentItem());
+		if (elmt && !elmt -> connexionsInternesAcceptees()) exclu = elmt;
+	}
+	Terminal *resultat = 0;
+	qreal distance_min = rayon * rayon;
+	foreach(Terminal *t, terminal_index.query(QRectF(p - QPointF(rayon, rayon), QSizeF(2 * rayon, 2 * rayon)))) {
+		if (t == depart || t -> nbConducteurs() || t -> bundle()) continue;
+		if (exclu && t -> parentItem() == exclu) continue;
+		QPointF d = terminal_index.rect(t).topLeft() - p;
+		qreal distance = d.x() * d.x() + d.y() * d.y();
+		if (distance <= distance_min) {
+			distance_min = distance;
+			resultat = t;
+		}
+	}
+	return(resultat);
+}
+
+/**
+	Suit le pointeur hors de toute pose de conducteur ou deplacement : la
+	borne survolee est trouvee dans l'index des bornes et seules l'ancienne et
+	la nouvelle borne survolees sont redessinees. Aucune borne n'accepte les
+	evenements de survol : la scene n'a pas a les distribuer.
+	@param e Evenement decrivant le mouvement de la souris
+*/
+void Schema::mouseMoveEvent(QGraphicsSceneMouseEvent *e) {
+	QGraphicsScene::mouseMoveEvent(e);
+	// pendant une pose de conducteur, la borne de depart gere la mise en evidence
+	if (!suivi_survol || mouseGrabberItem()) return;
+	setHoveredTerminal(terminalAt(e -> scenePos()));
+}
+
+/**
+	Active ou desactive le suivi de la borne survolee
+	@param suivi false pour ne plus chercher ni mettre en evidence la borne
+	sous le pointeur
+*/
+void Schema::setHoverTracking(bool suivi) {
+	suivi_survol = suivi;
+	if (!suivi) setHoveredTerminal(0);
+}
+
+/**
+	Gere la sortie du pointeur hors de la scene
+	@param e Un evenement
+	@return true si l'evenement a ete traite
+*/
+bool Schema::event(QEvent *e) {
+	if (e -> type() == QEvent::GraphicsSceneLeave) setHoveredTerminal(0);
+	return(QGraphicsScene::event(e));
+}
+
+/**
+	Change la borne mise en evidence sous le pointeur
+	@param t La borne survolee, ou 0
+*/
+void Schema::setHoveredTerminal(Terminal *t) {
+	if (t == borne_survolee) return;
+	if (borne_survolee) borne_survolee -> setHovered(false);
+	borne_survolee = t;
+	if (t) t -> setHovered(true);
+}
+
+/**
+	Change le curseur des vues du schema pendant la pose d'un conducteur. Le
+	curseur est porte par les vues et non par les bornes : un item ayant son
+	propre curseur obligerait la vue a chercher l'item sous le pointeur a
+	chaque mouvement.
+	@param pose true pendant la pose d'un conducteur
+*/
+void Schema::setWiringCursor(bool pose) {
+	foreach(QGraphicsView *v, views()) {
+		if (pose) v -> viewport() -> setCursor(Qt::CrossCursor);
+		else v -> viewport() -> unsetCursor();
+	}
+}
+
+/**
+	Retire un element de l'index spatial des elements ; les conducteurs qui le
+	contournaient sont reroutes.
+	@param e L'element retire du schema
+*/
+void Schema::elementRemoved(Element *e) {
+	empreinte.elementRemoved(e);
+	foreach(QGraphicsItem *qgi, e -> childItems()) {
+		if (Terminal *t = qgraphicsitem_cast<Terminal *>(qgi)) reseaux.removeTerminal(t);
+	}
+	indexTerminals(e, false);
+	if (borne_survolee && borne_survolee -> parentItem() == e) borne_survolee = 0;
+	if (!element_index.contains(e)) return;
+	QRectF ancien = element_index.rect(e);
+	element_index.remove(e);
+	QString type = QFileInfo(e -> typeId()).fileName();
+	if (-- comptes_types[type] <= 0) comptes_types.remove(type);
+	emit(contentChanged(ancien));
+	if (auto_routage) foreach(Conductor *c, conductor_index.query(ancien)) c -> markDirty();
+}
+
+/**
+	Retire des elements du schema, avec leurs conducteurs et leurs faisceaux.
+	Les items concernes sont recenses en une seule passe sur les bornes, puis
+	retires de la scene. L'index de la scene n'est suspendu pendant le retrait
+	que si celui-ci porte sur au moins SEUIL_INDEX_SUPPRESSION items et sur
+	une part notable des elements et conducteurs de la scene : sa
+	reconstruction parcourt toute la scene, ce qui ne vaut que lorsqu'une
+	grande partie de celle-ci disparait. Les items retires ne sont pas
+	detruits.
+	@param elements Les elements a retirer
+	@return Les items retires : conducteurs, faisceaux, puis elements
+*/
+QList<QGraphicsItem *> Schema::detachElements(const QList<Element *> &elements) {
+	QList<QGraphicsItem *> retires;
+	QSet<Element *> a_retirer;
+	QSet<Conductor *> conducteurs;
+	QSet<ConductorBundle *> faisceaux;
+	foreach(Element *e, elements) {
+		if (e -> scene() != this || a_retirer.contains(e)) continue;
+		a_retirer.insert(e);
+		foreach(QGraphicsItem *qgi, e -> childItems()) {
+			Terminal *t = qgraphicsitem_cast<Terminal *>(qgi);
+			if (!t) continue;
+			foreach(Conductor *c, t -> conducteurs()) conducteurs.insert(c);
+			if (t -> bundle()) faisceaux.insert(t -> bundle());
+		}
+	}
+	if (a_retirer.isEmpty()) return(retires);
+	// le deplacement groupe en cours reference peut-etre ces elements
+	endGroupMove();
+	if (borne_survolee && a_retirer.contains(qgraphicsitem_cast<Element *>(borne_survolee -> parentItem()))) {
+		setHoveredTerminal(0);
+	}
+	
+	ItemIndexMethod methode = itemIndexMethod();
+	int nb_retires = a_retirer.size() + conducteurs.size() + faisceaux.size();
+	int nb_scene = element_index.size() + conductor_index.size();
+	bool index_suspendu = methode != NoIndex && nb_retires >= SEUIL_INDEX_SUPPRESSION && nb_retires * FRACTION_INDEX_SUPPRESSION >= nb_scene;
+	if (index_suspendu) setItemIndexMethod(NoIndex);
+	beginBulkSelection();
+	foreach(Conductor *c, conducteurs) {
+		c -> destroy();
+		removeItem(c);
+		retires << c;
+	}
+	foreach(ConductorBundle *f, faisceaux) {
+		f -> destroy();
+		removeItem(f);
+		retires << f;
+	}
+	foreach(Element *e, a_retirer) {
+		removeItem(e);
+		retires << e;
+	}
+	endBulkSelection();
+	if (index_suspendu) setItemIndexMethod(methode);
+	return(retires);
+}
+
+/**
+	@return La zone du schema a exporter : le rectangle entourant tous les
+	items, augmente d'une marge de 5 % de sa largeur
+*/
+QRectF Schema::exportRect() {
+	// les conducteurs en attente doivent etre a jour avant de mesurer le schema
+	flushConductors();
 	QRectF vue = itemsBoundingRect();
 	// la marge  = 5 % de la longueur necessaire
 	qreal marge = 0.05 * vue.width();
 	vue.translate(-marge, -marge);
 	vue.setWidth(vue.width() + 2.0 * marge);
 	vue.setHeight(vue.height() + 2.0 * marge);
+	return(vue);
+}
+
+QImage Schema::toImage() {
+	
+	QRectF vue = exportRect();
 	QSize dimensions_image = vue.size().toSize();
 	
 	QImage pix = QImage(dimensions_image, QImage::Format_RGB32);
@@ -89,6 +846,73 @@ QImage Schema::toImage() {
 	return(pix);
 }
 
+/**
+	Exporte ou enregistre le schema dans un fichier
+	@param nom_fichier Chemin du fichier a ecrire
+	@param format png, svg, pdf ou qet ; s'il n'est pas precise, le format est
+	deduit de l'extension du fichier
+	@return true si l'export a reussi, false sinon (format inconnu notamment)
+*/
+bool Schema::exportTo(const QString &nom_fichier, QString format) {
+	if (format.isEmpty()) format = QFileInfo(nom_fichier).suffix();
+	format = format.toLower();
+	if (format == "png") {
+		QImage image = toImage();
+		return(!image.isNull() && image.save(nom_fichier, "PNG"));
+	}
+	else if (format == "svg") return(toSvg(nom_fichier));
+	else if (format == "pdf") return(toPdf(nom_fichier));
+	else if (format == "qet") return(toFile(nom_fichier));
+	return(false);
+}
+
+/**
+	Exporte le schema au format SVG
+	@param nom_fichier Chemin du fichier SVG a ecrire
+	@return true si l'export a reussi, false sinon
+*/
+bool Schema::toSvg(const QString &nom_fichier) {
+	QRectF vue = exportRect();
+	if (vue.isEmpty()) return(false);
+	QRectF cible(QPointF(0.0, 0.0), vue.size());
+	
+	QSvgGenerator generateur;
+	generateur.setFileName(nom_fichier);
+	generateur.setSize(vue.size().toSize());
+	generateur.setViewBox(cible);
+	generateur.setTitle(titre);
+	
+	QPainter p;
+	if (!p.begin(&generateur)) return(false);
+	p.setRenderHint(QPainter::Antialiasing, true);
+	render(&p, cible, vue, Qt::KeepAspectRatio);
+	p.end();
+	return(true);
+}
+
+/**
+	Exporte le schema au format PDF, sur une page aux dimensions du schema
+	@param nom_fichier Chemin du fichier PDF a ecrire
+	@return true si l'export a reussi, false sinon
+*/
+bool Schema::toPdf(const QString &nom_fichier) {
+	QRectF vue = exportRect();
+	if (vue.isEmpty()) return(false);
+	
+	QPdfWriter pdf(nom_fichier);
+	pdf.setTitle(titre);
+	pdf.setCreator("QElectroTech");
+	pdf.setPageSize(QPageSize(vue.size(), QPageSize::Point, QString(), QPageSize::ExactMatch));
+	pdf.setPageMargins(QMarginsF(0.0, 0.0, 0.0, 0.0));
+	
+	QPainter p;
+	if (!p.begin(&pdf)) return(false);
+	p.setRenderHint(QPainter::Antialiasing, true);
+	render(&p, QRectF(), vue, Qt::KeepAspectRatio);
+	p.end();
+	return(true);
+}
+
 /**
 	Exporte tout ou partie du schema 
 	@param schema Booleen (a vrai par defaut) indiquant si le XML genere doit representer tout le schema ou seulement les elements selectionnes
@@ -106,6 +930,7 @@ QDomDocument Schema::toXml(bool schema) {
 		if (!auteur.isNull()) racine.setAttribute("auteur", auteur);
 		if (!date.isNull())   racine.setAttribute("date", date.toString("yyyyMMdd"));
 		if (!titre.isNull())  racine.setAttribute("titre", titre);
+		racine.setAttribute("autorouting", auto_routage ? "true" : "false");
 	}
 	document.appendChild(racine);
 	
@@ -115,6 +940,7 @@ QDomDocument Schema::toXml(bool schema) {
 	// creation de deux listes : une qui contient les elements, une qui contient les conducteurs
 	QList<Element *> liste_elements;
 	QList<Conductor *> liste_conducteurs;
+	QList<ConductorBundle *> liste_faisceaux;
 	
 	
 	// Determine les elements a  XMLiser 
@@ -127,6 +953,9 @@ QDomDocument Schema::toXml(bool schema) {
 			// lorsqu'on n'exporte pas tout le schema, il faut retirer les conducteurs non selectionnes
 			// et pour l'instant, les conducteurs non selectionnes sont les conducteurs dont un des elements n'est pas relie
 			else if (f -> terminal1 -> parentItem() -> isSelected() && f -> terminal2 -> parentItem() -> isSelected()) liste_conducteurs << f;
+		} else if (ConductorBundle *fx = qgraphicsitem_cast<ConductorBundle *>(qgi)) {
+			if (schema) liste_faisceaux << fx;
+			else if (fx -> terminals1().first() -> parentItem() -> isSelected() && fx -> terminals2().first() -> parentItem() -> isSelected()) liste_faisceaux << fx;
 		}
 	}
 	
@@ -170,8 +999,19 @@ QDomDocument Schema::toXml(bool schema) {
 	racine.appendChild(elements);
 	
 	// enregistrement des conducteurs
-	if (liste_conducteurs.isEmpty()) return(document);
+	if (liste_conducteurs.isEmpty() && liste_faisceaux.isEmpty()) return(document);
 	QDomElement conducteurs = document.createElement("conducteurs");
+	// chaque liaison d'un faisceau est enregistree comme un conducteur, avec le numero du faisceau
+	for (int i = 0 ; i < liste_faisceaux.size() ; ++ i) {
+		ConductorBundle *fx = liste_faisceaux.at(i);
+		for (int j = 0 ; j < fx -> size() ; ++ j) {
+			QDomElement conductor = document.createElement("conductor");
+			conductor.setAttribute("terminal1", table_adr_id.value(fx -> terminals1().at(j)));
+			conductor.setAttribute("terminal2", table_adr_id.value(fx -> terminals2().at(j)));
+			conductor.setAttribute("bundle", i);
+			conducteurs.appendChild(conductor);
+		}
+	}
 	foreach(Conductor *f, liste_conducteurs) {
 		QDomElement conductor = document.createElement("conductor");
 		conductor.setAttribute("terminal1", table_adr_id.value(f -> terminal1));
@@ -184,8 +1024,34 @@ QDomDocument Schema::toXml(bool schema) {
 	return(document);
 }
 
+/**
+	Vide le schema : tous les elements et conducteurs sont detruits, le
+	cartouche est efface et le routage automatique revient a sa valeur par
+	defaut, comme pour un schema neuf. Le schema peut ensuite charger un autre fichier, ce
+	qui evite de recreer une scene pour chaque schema traite.
+*/
 void Schema::reset() {
-	/// @todo implementer cette fonction
+	endGroupMove();
+	// le poseur de conducteur n'appartient pas au contenu du schema
+	poseConducteur(false);
+	conductor_index.clear();
+	element_index.clear();
+	terminal_index.clear();
+	borne_survolee = 0;
+	conducteurs_a_recalculer.clear();
+	faisceaux_a_recalculer.clear();
+	croisements_a_recalculer.clear();
+	croisements.clear();
+	reseaux.clear();
+	comptes_types.clear();
+	empreinte.clear();
+	elements_selectionnes.clear();
+	clear();
+	auteur = QString();
+	titre  = QString();
+	date   = QDate();
+	// un fichier sans attribut "autorouting" ne doit pas heriter du precedent
+	auto_routage = false;
 }
 
 /**
@@ -202,6 +1068,8 @@ bool Schema::fromXml(QDomDocument &document, QPointF position) {
 	auteur = racine.attribute("auteur");
 	titre  = racine.attribute("titre");
 	date   = QDate::fromString(racine.attribute("date"), "yyyyMMdd");
+	// le routage automatique est propre a chaque document ; absent lors d'un collage
+	if (racine.hasAttribute("autorouting")) setAutoRouting(racine.attribute("autorouting") == "true");
 	
 	// si la racine n'a pas d'enfant : le chargement est fini (schema vide)
 	if (racine.firstChild().isNull()) return(true);
@@ -254,7 +1122,9 @@ bool Schema::fromXml(QDomDocument &document, QPointF position) {
 		}
 	}
 	
-	// chargement de tous les Conducteurs du fichier XML
+	// chargement de tous les Conducteurs du fichier XML ; les liaisons d'un meme
+	// faisceau sont regroupees puis creees ensemble
+	QMap<QString, QPair<QList<Terminal *>, QList<Terminal *> > > faisceaux;
 	for (QDomNode node = racine.firstChild() ; !node.isNull() ; node = node.nextSibling()) {
 		// on s'interesse a l'element XML "conducteurs" (= groupe de conducteurs)
 		QDomElement conducteurs = node.toElement();
@@ -275,11 +1145,81 @@ bool Schema::fromXml(QDomDocument &document, QPointF position) {
 					bool peut_poser_conducteur = true;
 					bool cia = ((Element *)p2 -> parentItem()) -> connexionsInternesAcceptees();
 					if (!cia) foreach(QGraphicsItem *item, p2 -> parentItem() -> childItems()) if (item == p1) peut_poser_conducteur = false;
-					if (peut_poser_conducteur) new Conductor(table_adr_id.value(id_p1), table_adr_id.value(id_p2), 0, this);
+					if (!peut_poser_conducteur) continue;
+					if (f.hasAttribute("bundle")) {
+						faisceaux[f.attribute("bundle")].first  << p1;
+						faisceaux[f.attribute("bundle")].second << p2;
+					} else new Conductor(p1, p2, 0, this);
 				}
 			} else qDebug() << "Le chargement du conductor" << id_p1 << id_p2 << "a echoue";
 		}
 	}
+	foreach(QString numero, faisceaux.keys()) {
+		QList<Terminal *> b1 = faisceaux[numero].first;
+		QList<Terminal *> b2 = faisceaux[numero].second;
+		// une borne n'appartient qu'a un faisceau : les liaisons en conflit deviennent des conducteurs
+		bool libre = b1.size() > 1;
+		for (int i = 0 ; libre && i < b1.size() ; ++ i) libre = !b1.at(i) -> bundle() && !b2.at(i) -> bundle();
+		if (libre) new ConductorBundle(b1, b2, this);
+		else for (int i = 0 ; i < b1.size() ; ++ i) new Conductor(b1.at(i), b2.at(i), 0, this);
+	}
+	return(true);
+}
+
+/**
+	Charge le schema depuis un fichier *.qet
+	@param nom_fichier Chemin du fichier a ouvrir
+	@param erreur Si le pointeur est precise, cet entier est mis a 0 en cas de reussite,
+	1 si le fichier n'existe pas,
+	2 si le fichier n'est pas lisible,
+	3 si le fichier n'est pas un document XML,
+	4 si le chargement du schema a echoue pour une autre raison
+	@return true si le chargement a reussi, false sinon
+*/
+bool Schema::fromFile(const QString &nom_fichier, int *erreur) {
+	// verifie l'existence du fichier
+	if (!QFileInfo(nom_fichier).exists()) {
+		if (erreur != NULL) *erreur = 1;
+		return(false);
+	}
+	
+	// ouvre le fichier
+	QFile file(nom_fichier);
+	if (!file.open(QIODevice::ReadOnly)) {
+		if (erreur != NULL) *erreur = 2;
+		return(false);
+	}
+	
+	// lit son contenu dans un QDomDocument
+	QDomDocument document;
+	if (!document.setContent(&file)) {
+		if (erreur != NULL) *erreur = 3;
+		file.close();
+		return(false);
+	}
+	file.close();
+	
+	// construit le schema a partir du QDomDocument
+	if (!fromXml(document)) {
+		if (erreur != NULL) *erreur = 4;
+		return(false);
+	}
+	if (erreur != NULL) *erreur = 0;
+	return(true);
+}
+
+/**
+	Enregistre le schema dans un fichier *.qet
+	@param nom_fichier Chemin du fichier a ecrire
+	@return true si l'enregistrement a reussi, false sinon
+*/
+bool Schema::toFile(const QString &nom_fichier) {
+	QFile file(nom_fichier);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return(false);
+	QTextStream out(&file);
+	out.setCodec("UTF-8");
+	out << toXml().toString(4);
+	file.close();
 	return(true);
 }
 
@@ -299,25 +1239,21 @@ Element *Schema::elementFromXml(QDomElement &e, QHash<int, Terminal *> &table_id
 		case 1: nvel_elmt = new DEL();        break;
 		case 2: nvel_elmt = new Entree();     break;
 	}*/
-	if (etat != 0) 
+	if (etat != 0) {
+		delete nvel_elmt;
 		return(nullptr);
+	}
 	bool retour = nvel_elmt -> fromXml(e, table_id_adr);
 	if (!retour) {
 		delete nvel_elmt;
 	} else {
-		// ajout de l'element au schema
+		// ajout de l'element au schema ; les drapeaux sont poses avant le
+		// positionnement afin que le schema soit notifie du deplacement
+		nvel_elmt -> setFlags(QGraphicsItem::ItemIsMovable | QGraphicsItem::ItemIsSelectable | QGraphicsItem::ItemSendsGeometryChanges);
 		addItem(nvel_elmt);
 		nvel_elmt -> setPos(e.attribute("x").toDouble(), e.attribute("y").toDouble());
-		nvel_elmt -> setFlags(QGraphicsItem::ItemIsMovable | QGraphicsItem::ItemIsSelectable);
 		if (e.attribute("sens") == "false") nvel_elmt -> invertOrientation();
 		nvel_elmt -> setSelected(e.attribute("selected") == "selected");
 	}
 	return(retour ? nvel_elmt : NULL);
 }
-
-void Schema::slot_checkSelectionChange() {
-	static QList<QGraphicsItem *> cache_selecteditems = QList<QGraphicsItem *>();
-	QList<QGraphicsItem *> selecteditems = selectedItems();
-	if (cache_selecteditems != selecteditems) emit(selectionChanged());
-	cache_selecteditems = selecteditems;
-}
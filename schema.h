@@ -2,17 +2,33 @@
 	#define SCHEMA_H
 	#define GRILLE_X 10
 	#define GRILLE_Y 10
+	/// zoom en deca duquel la selection est representee par une zone grossiere
+	#define ZOOM_SELECTION_GROSSIERE 0.4
+	/// cote des cellules de la zone grossiere de selection
+	#define CELLULE_SELECTION 50
+	/// distance en deca de laquelle un conducteur en cours de pose est aimante par une borne libre
+	#define RAYON_AIMANTATION 10.0
 	#include <QtWidgets>
 	#include <QtXml/QtXml>
+	#include <QtSvg/QSvgGenerator>
     #include <QDebug>
     #include <QUuid>
+	#include "spatialindex.h"
+	#include "conductorrouter.h"
+	#include "crossingfinder.h"
+	#include "netconnectivity.h"
+	#include "contenthash.h"
 	class Element;
 	class Terminal;
+	class Conductor;
+	class ConductorBundle;
+	class GroupMove;
 	class Schema : public QGraphicsScene {
 		Q_OBJECT
 		public:
 		Schema(QObject * = 0);
 		void drawBackground(QPainter *, const QRectF &);
+		void drawForeground(QPainter *, const QRectF &);
 		inline void poseConducteur(bool pf) {
 			if (pf) {
 				if (!poseur_de_conducteur -> scene()) addItem(poseur_de_conducteur);
@@ -23,14 +39,132 @@
 		inline void setDepart (QPointF d) { poseur_de_conducteur -> setLine(QLineF(d, poseur_de_conducteur -> line().p2())); }
 		inline void setArrivee(QPointF a) { poseur_de_conducteur -> setLine(QLineF(poseur_de_conducteur -> line().p1(), a)); }
 		QImage toImage();
+		bool toSvg(const QString &);
+		bool toPdf(const QString &);
+		bool exportTo(const QString &, QString = QString());
 		QDomDocument toXml(bool = true);
 		bool fromXml(QDomDocument &, QPointF = QPointF());
+		bool fromFile(const QString &, int * = NULL);
+		bool toFile(const QString &);
 		void reset();
 		QGraphicsItem *getElementById(uint id);
 		
+		// rendu des conducteurs en une seule passe
+		bool conductorLayer() const { return(conductor_layer); }
+		void setConductorLayer(bool);
+		void conductorGeometryChanged(Conductor *);
+		void conductorAdded(Conductor *);
+		void conductorRemoved(Conductor *);
+		
+		// recalcul differe des conducteurs
+		void markConductorDirty(Conductor *);
+		void markBundleDirty(ConductorBundle *);
+		
+		// faisceaux de conducteurs
+		ConductorBundle *bundleConductors(Element *, Element *);
+		void bundleAdded(ConductorBundle *);
+		void bundleRemoved(ConductorBundle *);
+		
+		// connectivite electrique
+		int netOf(Terminal *t) { return(reseaux.net(t)); }
+		bool connected(Terminal *a, Terminal *b) { return(reseaux.connected(a, b)); }
+		QList<Terminal *> netTerminals(int n) const { return(reseaux.terminals(n)); }
+		QList<int> nets() const { return(reseaux.nets()); }
+		
+		/// nombre d'elements poses, par type (nom du fichier de definition)
+		QHash<QString, int> elementTypeCounts() const { return(comptes_types); }
+		/// empreinte canonique du contenu, independante de l'ordre des items et des identifiants
+		quint64 contentHash() { return(empreinte.value()); }
+		
+		// routage automatique des conducteurs
+		bool autoRouting() const { return(auto_routage); }
+		void setAutoRouting(bool);
+		QPolygonF routeConductor(const QPointF &, Terminal::Orientation, const QPointF &, Terminal::Orientation) const;
+		void elementGeometryChanged(Element *);
+		void elementRemoved(Element *);
+		QList<QGraphicsItem *> detachElements(const QList<Element *> &);
+		int rerouteAll(int = 0);
+		bool pathIsClear(const QPolygonF &, const Conductor * = 0) const;
+		
+		// recherche des bornes, pour la pose des conducteurs
+		Terminal *terminalAt(const QPointF &) const;
+		Terminal *nearestFreeTerminal(const QPointF &, qreal, Terminal * = 0) const;
+		void setWiringCursor(bool);
+		/// borne sous le pointeur, mise en evidence, 0 si aucune
+		Terminal *hoveredTerminal() const { return(borne_survolee); }
+		void setHoverTracking(bool);
+		bool hoverTracking() const { return(suivi_survol); }
+		
+		// surcouche de selection
+		void elementSelectionChanged(Element *, bool);
+		void invalidateSelection(const QRectF &);
+		/// nombre d'elements selectionnes, tenu a jour par Element::itemChange
+		int selectedCount() const { return(elements_selectionnes.size()); }
+		QList<Element *> selectedElements() const { return(elements_selectionnes.toList()); }
+		
+		// selection en masse : un seul rafraichissement, un seul selectionChanged()
+		void setElementsSelected(const QList<Element *> &, bool);
+		void selectAllElements();
+		void clearElementSelection();
+		void invertSelection();
+		
+		// deplacement groupe de la selection
+		GroupMove *beginGroupMove();
+		GroupMove *groupMove() const { return(deplacement_groupe); }
+		void endGroupMove();
+		
 		private:
 		QGraphicsLineItem *poseur_de_conducteur;
 		bool doit_dessiner_grille;
+		/// index spatial des rectangles delimitant les conducteurs
+		SpatialIndex<Conductor *> conductor_index;
+		/// booleen indiquant si les conducteurs sont dessines en une seule passe par le schema
+		bool conductor_layer;
+		void drawConductorLayer(QPainter *, const QRectF &);
+		void indexConductor(Conductor *);
+		/// croisements entre conducteurs, dessines sous forme de sauts
+		CrossingFinder croisements;
+		/// conducteurs dont les croisements doivent etre recherches lors de la prochaine passe
+		QSet<Conductor *> croisements_a_recalculer;
+		void updateCrossings();
+		/// conducteurs dont le trace doit etre recalcule lors de la prochaine passe
+		QSet<Conductor *> conducteurs_a_recalculer;
+		QSet<ConductorBundle *> faisceaux_a_recalculer;
+		/// booleen indiquant si une passe de recalcul est deja planifiee
+		bool recalcul_planifie;
+		/// index spatial des rectangles delimitant les elements, obstacles du routage
+		SpatialIndex<Element *> element_index;
+		/// index spatial des points d'amarrage des bornes, tenu a jour avec celui des elements
+		SpatialIndex<Terminal *> terminal_index;
+		void indexTerminals(Element *, bool);
+		/// borne mise en evidence sous le pointeur
+		Terminal *borne_survolee;
+		/// booleen indiquant si le Schema suit la borne survolee
+		bool suivi_survol;
+		void setHoveredTerminal(Terminal *);
+		ConductorRouter routeur;
+		/// booleen indiquant si les conducteurs evitent les elements
+		bool auto_routage;
+		/// elements selectionnes, tenus a jour par Element::itemChange
+		QSet<Element *> elements_selectionnes;
+		/// deplacement groupe en cours, 0 si aucun
+		GroupMove *deplacement_groupe;
+		/// booleen indiquant si l'emission de selectionChanged() est deja planifiee
+		bool signal_selection_planifie;
+		/// profondeur des selections en masse en cours
+		int selection_groupee;
+		/// zone dont la selection a change pendant la selection en masse
+		QRectF zone_selection_groupee;
+		void beginBulkSelection();
+		void endBulkSelection();
+		/// reseaux electriques formes par les conducteurs et les faisceaux
+		NetConnectivity reseaux;
+		/// nombre d'elements de chaque type, tenu a jour avec l'index des elements
+		QHash<QString, int> comptes_types;
+		/// empreinte du contenu, tenue a jour avec l'index des elements et les reseaux
+		ContentHash empreinte;
+		void drawSelectionOverlay(QPainter *, const QRectF &);
+		QRectF exportRect();
 		// elements du cartouche
 		QString auteur;
 		QDate   date;
@@ -38,11 +172,23 @@
 		QString folio;       // vraiment necessaire ce truc ?
 		QString nom_fichier; // meme remarque
 		Element *elementFromXml(QDomElement &e, QHash<int, Terminal *> &);
+		
+		protected:
+		bool event(QEvent *);
+		void mouseMoveEvent(QGraphicsSceneMouseEvent *);
 
+		public slots:
+		void flushConductors();
+		
 		private slots:
-		void slot_checkSelectionChange();
+		void emitSelectionChanged();
 		
 		signals:
+		/// la selection a change ; emis une fois par serie de changements
 		void selectionChanged();
+		/// une zone du schema a change (element deplace, ajoute ou retire, conducteur modifie)
+		void contentChanged(const QRectF &);
+		/// le reseau d'une borne a change ; emis tant que la borne existe
+		void connectivityChanged(Terminal *);
 	};
 #endif
@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <QPainter>
+#include "schemadiff.h"
+#include "spatialindex.h"
+#include "elementdefinition.h"
+
+/// distance maximale entre deux positions d'un element deplace, apparie par proximite
+#define RAYON_DIFF 200.0
+
+/**
+	Compare deux revisions d'un schema
+	@param a Ancienne revision
+	@param b Nouvelle revision
+*/
+SchemaDiff::SchemaDiff(const SchemaModel &a, const SchemaModel &b) :
+	ancien(a),
+	nouveau(b),
+	appariement(a.elements.size(), -1),
+	appariement_inverse(b.elements.size(), -1)
+{
+	apparieParPosition();
+	apparieParSignature();
+	apparieParProximite();
+	for (int i = 0 ; i < appariement.size() ; ++ i) {
+		int j = appariement.at(i);
+		if (j == -1) supprimes << i;
+		else if (ancien.elements.at(i).pos != nouveau.elements.at(j).pos) deplaces << qMakePair(i, j);
+	}
+	for (int j = 0 ; j < appariement_inverse.size() ; ++ j) {
+		if (appariement_inverse.at(j) == -1) ajoutes << j;
+	}
+	compareLiaisons();
+}
+
+/**
+	@return true si les deux revisions sont structurellement identiques
+*/
+bool SchemaDiff::isEmpty() const {
+	return(ajoutes.isEmpty() && supprimes.isEmpty() && deplaces.isEmpty() && liaisons_ajoutees.isEmpty() && liaisons_supprimees.isEmpty());
+}
+
+/**
+	Apparie deux elements
+	@param i Indice dans l'ancienne revision
+	@param j Indice dans la nouvelle revision
+*/
+void SchemaDiff::apparie(int i, int j) {
+	appariement[i] = j;
+	appariement_inverse[j] = i;
+}
+
+/**
+	Apparie les elements de meme type poses exactement au meme endroit
+*/
+void SchemaDiff::apparieParPosition() {
+	QMultiHash<QString, int> positions;
+	for (int j = 0 ; j < nouveau.elements.size() ; ++ j) {
+		const SchemaModel::Elmt &e = nouveau.elements.at(j);
+		positions.insert(QString("%1|%2|%3").arg(e.type).arg(e.pos.x()).arg(e.pos.y()), j);
+	}
+	for (int i = 0 ; i < ancien.elements.size() ; ++ i) {
+		const SchemaModel::Elmt &e = ancien.elements.at(i);
+		QMultiHash<QString, int>::iterator it = positions.find(QString("%1|%2|%3").arg(e.type).arg(e.pos.x()).arg(e.pos.y()));
+		if (it == positions.end()) continue;
+		apparie(i, it.value());
+		positions.erase(it);
+	}
+}
+
+/**
+	Calcule la signature de connectivite de chaque element : son type et, pour
+	chacune de ses bornes, le type et la borne des elements auxquels elle est
+	reliee. Deux revisions d'un element deplace sans etre rebranche ont la meme
+	signature.
+	@param m Un schema
+	@return Les signatures, dans l'ordre des elements
+*/
+QVector<quint64> SchemaDiff::signatures(const SchemaModel &m) {
+	QVector<quint64> types(m.elements.size());
+	for (int i = 0 ; i < m.elements.size() ; ++ i) types[i] = qHash(m.elements.at(i).type);
+	
+	QVector<QVector<quint64> > voisins(m.elements.size());
+	foreach(const SchemaModel::Conducteur &c, m.conducteurs) {
+		voisins[c.e1.element] << ((quint64(c.e1.borne) << 48) ^ (types.at(c.e2.element) << 8) ^ quint64(c.e2.borne));
+		voisins[c.e2.element] << ((quint64(c.e2.borne) << 48) ^ (types.at(c.e1.element) << 8) ^ quint64(c.e1.borne));
+	}
+	QVector<quint64> resultat(m.elements.size());
+	for (int i = 0 ; i < m.elements.size() ; ++ i) {
+		QVector<quint64> &v = voisins[i];
+		std::sort(v.begin(), v.end());
+		quint64 h = types.at(i);
+		foreach(quint64 x, v) h = h * Q_UINT64_C(1099511628211) ^ x;
+		resultat[i] = h;
+	}
+	return(resultat);
+}
+
+/**
+	Apparie les elements restants dont la signature de connectivite n'apparait
+	qu'une fois parmi les elements restants de chaque revision
+*/
+void SchemaDiff::apparieParSignature() {
+	QVector<quint64> sa = signatures(ancien);
+	QVector<quint64> sb = signatures(nouveau);
+	// -2 : signature presente plusieurs fois
+	QHash<quint64, int> uniques_a, uniques_b;
+	for (int i = 0 ; i < sa.size() ; ++ i) {
+		if (appariement.at(i) != -1) continue;
+		uniques_a.insert(sa.at(i), uniques_a.contains(sa.at(i)) ? -2 : i);
+	}
+	for (int j = 0 ; j < sb.size() ; ++ j) {
+		if (appariement_inverse.at(j) != -1) continue;
+		uniques_b.insert(sb.at(j), uniques_b.contains(sb.at(j)) ? -2 : j);
+	}
+	for (QHash<quint64, int>::const_iterator it = uniques_a.constBegin() ; it != uniques_a.constEnd() ; ++ it) {
+		int j = uniques_b.value(it.key(), -1);
+		if (it.value() < 0 || j < 0) continue;
+		// une signature ne designe qu'un type : la verification evite les collisions
+		if (ancien.elements.at(it.value()).type != nouveau.elements.at(j).type) continue;
+		apparie(it.value(), j);
+	}
+}
+
+/**
+	Apparie chaque element restant avec l'element restant de meme type le plus
+	proche dans la nouvelle revision, a moins de RAYON_DIFF
+*/
+void SchemaDiff::apparieParProximite() {
+	SpatialIndex<int> restants(RAYON_DIFF);
+	for (int j = 0 ; j < nouveau.elements.size() ; ++ j) {
+		if (appariement_inverse.at(j) == -1) restants.insert(j, QRectF(nouveau.elements.at(j).pos, QSizeF(0.0, 0.0)));
+	}
+	if (!restants.size()) return;
+	for (int i = 0 ; i < ancien.elements.size() ; ++ i) {
+		if (appariement.at(i) != -1) continue;
+		const SchemaModel::Elmt &e = ancien.elements.at(i);
+		QRectF zone(e.pos - QPointF(RAYON_DIFF, RAYON_DIFF), QSizeF(2 * RAYON_DIFF, 2 * RAYON_DIFF));
+		int meilleur = -1;
+		qreal distance_min = RAYON_DIFF * RAYON_DIFF;
+		foreach(int j, restants.query(zone)) {
+			if (nouveau.elements.at(j).type != e.type) continue;
+			QPointF d = nouveau.elements.at(j).pos - e.pos;
+			qreal distance = d.x() * d.x() + d.y() * d.y();
+			if (distance <= distance_min) {
+				distance_min = distance;
+				meilleur = j;
+			}
+		}
+		if (meilleur == -1) continue;
+		apparie(i, meilleur);
+		restants.remove(meilleur);
+	}
+}
+
+/**
+	Compare les conducteurs : un conducteur de l'ancienne revision est conserve
+	si ses deux extremites, traduites dans la nouvelle revision, y sont reliees.
+*/
+void SchemaDiff::compareLiaisons() {
+	QHash<QPair<quint64, quint64>, int> liaisons;
+	for (int k = 0 ; k < nouveau.conducteurs.size() ; ++ k) {
+		quint64 a = SchemaModel::key(nouveau.conducteurs.at(k).e1);
+		quint64 b = SchemaModel::key(nouveau.conducteurs.at(k).e2);
+		liaisons.insertMulti(qMakePair(qMin(a, b), qMax(a, b)), k);
+	}
+	for (int k = 0 ; k < ancien.conducteurs.size() ; ++ k) {
+		const SchemaModel::Conducteur &c = ancien.conducteurs.at(k);
+		int j1 = appariement.at(c.e1.element);
+		int j2 = appariement.at(c.e2.element);
+		if (j1 == -1 || j2 == -1) {
+			liaisons_supprimees << k;
+			continue;
+		}
+		SchemaModel::Extremite x1 = { j1, c.e1.borne };
+		SchemaModel::Extremite x2 = { j2, c.e2.borne };
+		quint64 a = SchemaModel::key(x1);
+		quint64 b = SchemaModel::key(x2);
+		QHash<QPair<quint64, quint64>, int>::iterator it = liaisons.find(qMakePair(qMin(a, b), qMax(a, b)));
+		if (it == liaisons.end()) liaisons_supprimees << k;
+		else liaisons.erase(it);
+	}
+	foreach(int k, liaisons) liaisons_ajoutees << k;
+	std::sort(liaisons_ajoutees.begin(), liaisons_ajoutees.end());
+}
+
+/**
+	Ecrit la liste des differences, une par ligne
+	@param flux Flux sur lequel ecrire
+*/
+void SchemaDiff::writeReport(QTextStream &flux) const {
+	foreach(int i, supprimes) {
+		const SchemaModel::Elmt &e = ancien.elements.at(i);
+		flux << "- element " << e.type << " (" << e.pos.x() << ", " << e.pos.y() << ")" << "\n";
+	}
+	foreach(int j, ajoutes) {
+		const SchemaModel::Elmt &e = nouveau.elements.at(j);
+		flux << "+ element " << e.type << " (" << e.pos.x() << ", " << e.pos.y() << ")" << "\n";
+	}
+	for (int k = 0 ; k < deplaces.size() ; ++ k) {
+		const SchemaModel::Elmt &a = ancien.elements.at(deplaces.at(k).first);
+		const SchemaModel::Elmt &b = nouveau.elements.at(deplaces.at(k).second);
+		flux << "~ element " << a.type << " (" << a.pos.x() << ", " << a.pos.y() << ") -> (" << b.pos.x() << ", " << b.pos.y() << ")" << "\n";
+	}
+	foreach(int k, liaisons_supprimees) {
+		const SchemaModel::Conducteur &c = ancien.conducteurs.at(k);
+		flux << "- conducteur " << ancien.elements.at(c.e1.element).type << ":" << (c.e1.borne + 1);
+		flux << " " << ancien.elements.at(c.e2.element).type << ":" << (c.e2.borne + 1) << "\n";
+	}
+	foreach(int k, liaisons_ajoutees) {
+		const SchemaModel::Conducteur &c = nouveau.conducteurs.at(k);
+		flux << "+ conducteur " << nouveau.elements.at(c.e1.element).type << ":" << (c.e1.borne + 1);
+		flux << " " << nouveau.elements.at(c.e2.element).type << ":" << (c.e2.borne + 1) << "\n";
+	}
+}
+
+/**
+	@param e Un element
+	@return Le rectangle occupe par l'element, d'apres sa definition
+*/
+QRectF SchemaDiff::elementRect(const SchemaModel::Elmt &e) {
+	const ElementDefinition *definition = ElementDefinition::get("elements/" + e.type);
+	if (definition -> largeur() <= 0 || definition -> hauteur() <= 0) return(QRectF(e.pos - QPointF(10.0, 10.0), QSizeF(20.0, 20.0)));
+	return(QRectF(e.pos - definition -> hotspot(), QSizeF(definition -> largeur(), definition -> hauteur())));
+}
+
+/**
+	Superpose les differences au rendu d'une revision : elements supprimes en
+	rouge, ajoutes en vert, deplaces en orange (avec leur ancienne position),
+	conducteurs supprimes en rouge et ajoutes en vert, en pointilles.
+	@param rendu Rendu de la nouvelle revision
+	@param source Zone du schema couverte par le rendu
+	@return Le rendu annote
+*/
+QImage SchemaDiff::renderOverlay(const QImage &rendu, const QRectF &source) const {
+	QImage image = rendu.convertToFormat(QImage::Format_ARGB32);
+	QPainter p(&image);
+	p.setRenderHint(QPainter::Antialiasing, true);
+	p.scale(image.width() / source.width(), image.height() / source.height());
+	p.translate(-source.topLeft());
+	
+	QColor rouge(220, 0, 0), vert(0, 160, 0), orange(255, 140, 0);
+	p.setBrush(Qt::NoBrush);
+	p.setPen(QPen(rouge, 2.0));
+	foreach(int i, supprimes) p.drawRect(elementRect(ancien.elements.at(i)));
+	p.setPen(QPen(vert, 2.0));
+	foreach(int j, ajoutes) p.drawRect(elementRect(nouveau.elements.at(j)));
+	for (int k = 0 ; k < deplaces.size() ; ++ k) {
+		QRectF avant = elementRect(ancien.elements.at(deplaces.at(k).first));
+		QRectF apres = elementRect(nouveau.elements.at(deplaces.at(k).second));
+		p.setPen(QPen(orange, 1.0, Qt::DashLine));
+		p.drawRect(avant);
+		p.drawLine(avant.center(), apres.center());
+		p.setPen(QPen(orange, 2.0));
+		p.drawRect(apres);
+	}
+	
+	// conducteurs : segment entre les deux bornes
+	p.setPen(QPen(rouge, 2.0, Qt::DashLine));
+	foreach(int k, liaisons_supprimees) {
+		const SchemaModel::Conducteur &c = ancien.conducteurs.at(k);
+		const SchemaModel::Elmt &e1 = ancien.elements.at(c.e1.element);
+		const SchemaModel::Elmt &e2 = ancien.elements.at(c.e2.element);
+		const SchemaModel::Borne &b1 = e1.bornes.at(c.e1.borne);
+		const SchemaModel::Borne &b2 = e2.bornes.at(c.e2.borne);
+		p.drawLine(e1.pos + QPointF(b1.x, b1.y), e2.pos + QPointF(b2.x, b2.y));
+	}
+	p.setPen(QPen(vert, 2.0, Qt::DashLine));
+	foreach(int k, liaisons_ajoutees) {
+		const SchemaModel::Conducteur &c = nouveau.conducteurs.at(k);
+		const SchemaModel::Elmt &e1 = nouveau.elements.at(c.e1.element);
+		const SchemaModel::Elmt &e2 = nouveau.elements.at(c.e2.element);
+		const SchemaModel::Borne &b1 = e1.bornes.at(c.e1.borne);
+		const SchemaModel::Borne &b2 = e2.bornes.at(c.e2.borne);
+		p.drawLine(e1.pos + QPointF(b1.x, b1.y), e2.pos + QPointF(b2.x, b2.y));
+	}
+	p.end();
+	return(image);
+}
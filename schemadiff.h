@@ -0,0 +1,56 @@
+#ifndef SCHEMADIFF_H
+	#define SCHEMADIFF_H
+	#include <QtCore>
+	#include <QImage>
+	#include "schemamodel.h"
+	/**
+		Comparaison structurelle de deux revisions d'un schema. Les elements sont
+		apparies :
+		  - par type et position, a l'aide d'une table de hachage ;
+		  - a defaut, par signature de connectivite (type de l'element et des
+		    elements relies a chacune de ses bornes), lorsqu'elle est unique ;
+		  - a defaut, avec l'element de meme type le plus proche, trouve a l'aide
+		    d'un index spatial.
+		Les elements non apparies sont ajoutes ou supprimes ; les conducteurs
+		sont compares une fois leurs extremites traduites d'une revision a l'autre.
+	*/
+	class SchemaDiff {
+		public:
+		SchemaDiff(const SchemaModel &, const SchemaModel &);
+		
+		/// indices, dans la nouvelle revision, des elements ajoutes
+		QVector<int> added() const { return(ajoutes); }
+		/// indices, dans l'ancienne revision, des elements supprimes
+		QVector<int> removed() const { return(supprimes); }
+		/// elements deplaces : indice dans l'ancienne revision, indice dans la nouvelle
+		QVector<QPair<int, int> > moved() const { return(deplaces); }
+		/// indices, dans la nouvelle revision, des conducteurs ajoutes
+		QVector<int> addedConnections() const { return(liaisons_ajoutees); }
+		/// indices, dans l'ancienne revision, des conducteurs supprimes
+		QVector<int> removedConnections() const { return(liaisons_supprimees); }
+		/// element de la nouvelle revision apparie a un element de l'ancienne, -1 si aucun
+		int match(int i) const { return(appariement.at(i)); }
+		bool isEmpty() const;
+		
+		void writeReport(QTextStream &) const;
+		QImage renderOverlay(const QImage &, const QRectF &) const;
+		static QRectF elementRect(const SchemaModel::Elmt &);
+		
+		private:
+		const SchemaModel &ancien;
+		const SchemaModel &nouveau;
+		QVector<int> appariement;
+		QVector<int> appariement_inverse;
+		QVector<int> ajoutes;
+		QVector<int> supprimes;
+		QVector<QPair<int, int> > deplaces;
+		QVector<int> liaisons_ajoutees;
+		QVector<int> liaisons_supprimees;
+		void apparie(int, int);
+		void apparieParPosition();
+		void apparieParSignature();
+		void apparieParProximite();
+		void compareLiaisons();
+		static QVector<quint64> signatures(const SchemaModel &);
+	};
+#endif
@@ -0,0 +1,203 @@
+#include "schemamerge.h"
+
+/**
+	Fusionne deux revisions d'un schema
+	@param b Revision commune
+	@param n Notre revision
+	@param e Leur revision
+*/
+SchemaMerge::SchemaMerge(const SchemaModel &b, const SchemaModel &n, const SchemaModel &e) :
+	base(b),
+	nous(n),
+	eux(e),
+	diff_nous(b, n),
+	diff_eux(b, e),
+	depuis_base(b.elements.size(), -1),
+	depuis_nous(n.elements.size(), -1),
+	depuis_eux(e.elements.size(), -1)
+{
+	fusionneProprietes();
+	fusionneElements();
+	fusionneConducteurs();
+}
+
+/**
+	Fusionne les attributs du schema (auteur, date, titre...) un par un
+*/
+void SchemaMerge::fusionneProprietes() {
+	QSet<QString> cles = QSet<QString>::fromList(base.proprietes.keys());
+	cles += QSet<QString>::fromList(nous.proprietes.keys());
+	cles += QSet<QString>::fromList(eux.proprietes.keys());
+	foreach(QString cle, cles) {
+		// un attribut absent est distingue d'un attribut vide
+		QPair<bool, QString> v_base(base.proprietes.contains(cle), base.proprietes.value(cle));
+		QPair<bool, QString> v_nous(nous.proprietes.contains(cle), nous.proprietes.value(cle));
+		QPair<bool, QString> v_eux(eux.proprietes.contains(cle), eux.proprietes.value(cle));
+		QPair<bool, QString> valeur = v_nous;
+		if (v_nous == v_base) valeur = v_eux;
+		else if (v_eux != v_base && v_eux != v_nous) {
+			conflits << QString("attribut %1 : \"%2\" / \"%3\"").arg(cle).arg(v_nous.second).arg(v_eux.second);
+		}
+		if (valeur.first) fusion.proprietes.insert(cle, valeur.second);
+	}
+}
+
+/**
+	Ajoute un element au schema fusionne
+	@param elmt L'element a ajouter
+	@param conflit true si l'element fait l'objet d'un conflit
+	@return L'indice de l'element dans le schema fusionne
+*/
+int SchemaMerge::ajoute(const SchemaModel::Elmt &elmt, bool conflit) {
+	fusion.elements << elmt;
+	fusion.elements.last().selectionne = conflit;
+	return(fusion.elements.size() - 1);
+}
+
+/**
+	Fusionne les elements : ceux de la revision commune d'abord, dans leur
+	ordre, puis ceux ajoutes de notre cote, puis ceux ajoutes de leur cote.
+*/
+void SchemaMerge::fusionneElements() {
+	for (int i = 0 ; i < base.elements.size() ; ++ i) {
+		const SchemaModel::Elmt &origine = base.elements.at(i);
+		int j = diff_nous.match(i);
+		int k = diff_eux.match(i);
+		if (j == -1 && k == -1) continue;
+		if (j == -1 || k == -1) {
+			// supprime d'un cote : conflit s'il a ete modifie de l'autre
+			const SchemaModel::Elmt &reste = j == -1 ? eux.elements.at(k) : nous.elements.at(j);
+			if (reste.pos == origine.pos && reste.sens == origine.sens) continue;
+			conflits << QString("%1 supprime %2 et modifie %3").arg(decrit(origine)).arg(j == -1 ? "par nous" : "par eux").arg(j == -1 ? "par eux" : "par nous");
+			int index = ajoute(reste, true);
+			depuis_base[i] = index;
+			if (j == -1) depuis_eux[k] = index;
+			else depuis_nous[j] = index;
+			continue;
+		}
+		const SchemaModel::Elmt &n = nous.elements.at(j);
+		const SchemaModel::Elmt &e = eux.elements.at(k);
+		SchemaModel::Elmt elmt = n;
+		bool conflit = false;
+		if (n.pos == origine.pos) elmt.pos = e.pos;
+		else if (e.pos != origine.pos && e.pos != n.pos) conflit = true;
+		if (n.sens == origine.sens) elmt.sens = e.sens;
+		else if (e.sens != origine.sens && e.sens != n.sens) conflit = true;
+		if (conflit) {
+			conflits << QString("%1 deplace des deux cotes : (%2, %3) / (%4, %5)").arg(decrit(origine)).arg(n.pos.x()).arg(n.pos.y()).arg(e.pos.x()).arg(e.pos.y());
+		}
+		int index = ajoute(elmt, conflit);
+		depuis_base[i] = index;
+		depuis_nous[j] = index;
+		depuis_eux[k] = index;
+	}
+	
+	// un element ajoute a l'identique des deux cotes n'est repris qu'une fois
+	QMultiHash<QString, int> nos_ajouts;
+	foreach(int j, diff_nous.added()) {
+		const SchemaModel::Elmt &n = nous.elements.at(j);
+		depuis_nous[j] = ajoute(n, false);
+		nos_ajouts.insert(QString("%1|%2|%3").arg(n.type).arg(n.pos.x()).arg(n.pos.y()), depuis_nous.at(j));
+	}
+	foreach(int k, diff_eux.added()) {
+		const SchemaModel::Elmt &e = eux.elements.at(k);
+		QMultiHash<QString, int>::iterator it = nos_ajouts.find(QString("%1|%2|%3").arg(e.type).arg(e.pos.x()).arg(e.pos.y()));
+		if (it != nos_ajouts.end()) {
+			depuis_eux[k] = it.value();
+			nos_ajouts.erase(it);
+		} else depuis_eux[k] = ajoute(e, false);
+	}
+}
+
+/**
+	Traduit les extremites d'un conducteur dans le schema fusionne
+	@param c Un conducteur
+	@param correspondance Indice dans le schema fusionne des elements de la revision du conducteur
+	@param liaison Recoit les cles des deux extremites, dans l'ordre
+	@return false si l'un des elements du conducteur n'est pas dans le schema fusionne
+*/
+bool SchemaMerge::traduit(const SchemaModel::Conducteur &c, const QVector<int> &correspondance, QPair<quint64, quint64> *liaison) {
+	int e1 = correspondance.at(c.e1.element);
+	int e2 = correspondance.at(c.e2.element);
+	if (e1 == -1 || e2 == -1) return(false);
+	SchemaModel::Extremite x1 = { e1, c.e1.borne };
+	SchemaModel::Extremite x2 = { e2, c.e2.borne };
+	quint64 a = SchemaModel::key(x1);
+	quint64 b = SchemaModel::key(x2);
+	*liaison = qMakePair(qMin(a, b), qMax(a, b));
+	return(true);
+}
+
+/**
+	Fusionne les conducteurs : un conducteur de la revision commune est garde
+	s'il l'est des deux cotes, un conducteur ajoute d'un cote est repris. Un
+	conducteur ajoute d'un cote sur un element supprime de l'autre est un
+	conflit ; il est abandonne.
+*/
+void SchemaMerge::fusionneConducteurs() {
+	QPair<quint64, quint64> liaison;
+	QSet<QPair<quint64, quint64> > liaisons_base, nos_liaisons, leurs_liaisons;
+	foreach(const SchemaModel::Conducteur &c, base.conducteurs) {
+		if (traduit(c, depuis_base, &liaison)) liaisons_base << liaison;
+	}
+	foreach(const SchemaModel::Conducteur &c, nous.conducteurs) {
+		if (traduit(c, depuis_nous, &liaison)) nos_liaisons << liaison;
+	}
+	foreach(const SchemaModel::Conducteur &c, eux.conducteurs) {
+		if (traduit(c, depuis_eux, &liaison)) leurs_liaisons << liaison;
+	}
+	
+	// un numero de faisceau n'est que le rang du faisceau dans son fichier : le
+	// meme numero peut designer des faisceaux differents d'une revision a
+	// l'autre. Chaque faisceau repris est renumerote, d'apres sa revision et
+	// son numero d'origine ; un faisceau de leur cote dont une liaison a deja
+	// ete reprise de notre cote prend le numero de cette liaison.
+	QHash<QPair<int, QString>, QString> numeros;
+	QHash<QPair<quint64, quint64>, QString> faisceau_repris;
+	int nb_faisceaux = 0;
+	
+	QSet<QPair<quint64, quint64> > repris;
+	for (int cote = 0 ; cote < 2 ; ++ cote) {
+		const SchemaModel &revision = cote ? eux : nous;
+		const QVector<int> &correspondance = cote ? depuis_eux : depuis_nous;
+		const QSet<QPair<quint64, quint64> > &autres = cote ? nos_liaisons : leurs_liaisons;
+		QVector<int> liste_ajoutes = cote ? diff_eux.addedConnections() : diff_nous.addedConnections();
+		QSet<int> ajoutes = QSet<int>::fromList(liste_ajoutes.toList());
+		foreach(const SchemaModel::Conducteur &c, revision.conducteurs) {
+			if (c.faisceau.isEmpty() || !traduit(c, correspondance, &liaison) || !faisceau_repris.contains(liaison)) continue;
+			QPair<int, QString> cle(cote, c.faisceau);
+			if (!numeros.contains(cle)) numeros.insert(cle, faisceau_repris.value(liaison));
+		}
+		for (int k = 0 ; k < revision.conducteurs.size() ; ++ k) {
+			const SchemaModel::Conducteur &c = revision.conducteurs.at(k);
+			if (!traduit(c, correspondance, &liaison)) {
+				if (ajoutes.contains(k)) {
+					int absent = correspondance.at(c.e1.element) == -1 ? c.e1.element : c.e2.element;
+					conflits << QString("conducteur ajoute %1 sur %2, supprime %3").arg(cote ? "par eux" : "par nous").arg(decrit(revision.elements.at(absent))).arg(cote ? "par nous" : "par eux");
+				}
+				continue;
+			}
+			if (repris.contains(liaison)) continue;
+			if (liaisons_base.contains(liaison) && !autres.contains(liaison)) continue;
+			SchemaModel::Conducteur conducteur = c;
+			conducteur.e1.element = correspondance.at(c.e1.element);
+			conducteur.e2.element = correspondance.at(c.e2.element);
+			if (!c.faisceau.isEmpty()) {
+				QPair<int, QString> cle(cote, c.faisceau);
+				if (!numeros.contains(cle)) numeros.insert(cle, QString::number(nb_faisceaux ++));
+				conducteur.faisceau = numeros.value(cle);
+				faisceau_repris.insert(liaison, conducteur.faisceau);
+			}
+			fusion.conducteurs << conducteur;
+			repris << liaison;
+		}
+	}
+}
+
+/**
+	@param elmt Un element
+	@return Une description courte de l'element pour la liste des conflits
+*/
+QString SchemaMerge::decrit(const SchemaModel::Elmt &elmt) {
+	return(QString("element %1 (%2, %3)").arg(elmt.type).arg(elmt.pos.x()).arg(elmt.pos.y()));
+}
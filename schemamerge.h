@@ -0,0 +1,48 @@
+#ifndef SCHEMAMERGE_H
+	#define SCHEMAMERGE_H
+	#include <QtCore>
+	#include "schemamodel.h"
+	#include "schemadiff.h"
+	/**
+		Fusion a trois voies de deux revisions d'un schema issues d'une revision
+		commune. Les elements sont apparies a la revision commune par SchemaDiff ;
+		un element modifie d'un seul cote prend cette modification, un element
+		supprime d'un cote et inchange de l'autre est supprime, et les elements
+		ajoutes de chaque cote sont repris (une seule fois s'ils ont ete ajoutes
+		a l'identique des deux cotes). Un conducteur de la revision commune est
+		conserve s'il l'est des deux cotes ; les conducteurs ajoutes d'un cote ou
+		de l'autre sont repris. Les faisceaux repris sont renumerotes : un numero
+		de faisceau n'est qu'un rang dans son fichier.
+		Les modifications incompatibles sont des conflits : la version "nous" est
+		retenue, le conflit est decrit dans conflicts() et les elements concernes
+		sont enregistres selectionnes pour etre reperes a l'ouverture du schema.
+	*/
+	class SchemaMerge {
+		public:
+		SchemaMerge(const SchemaModel &, const SchemaModel &, const SchemaModel &);
+		
+		/// schema fusionne ; ses identifiants de bornes sont renumerotes a l'ecriture
+		const SchemaModel &result() const { return(fusion); }
+		QStringList conflicts() const { return(conflits); }
+		bool hasConflicts() const { return(!conflits.isEmpty()); }
+		
+		private:
+		const SchemaModel &base;
+		const SchemaModel &nous;
+		const SchemaModel &eux;
+		SchemaDiff diff_nous;
+		SchemaDiff diff_eux;
+		SchemaModel fusion;
+		QStringList conflits;
+		/// indice dans le schema fusionne des elements de chaque revision, -1 si aucun
+		QVector<int> depuis_base;
+		QVector<int> depuis_nous;
+		QVector<int> depuis_eux;
+		void fusionneProprietes();
+		void fusionneElements();
+		void fusionneConducteurs();
+		int ajoute(const SchemaModel::Elmt &, bool);
+		static bool traduit(const SchemaModel::Conducteur &, const QVector<int> &, QPair<quint64, quint64> *);
+		static QString decrit(const SchemaModel::Elmt &);
+	};
+#endif
@@ -0,0 +1,181 @@
+#include "schemamodel.h"
+
+/**
+	@param e Une extremite de conducteur
+	@return Une cle unique pour cette extremite
+*/
+quint64 SchemaModel::key(const Extremite &e) {
+	return((quint64(quint32(e.element)) << 32) | quint32(e.borne));
+}
+
+uint qHash(const SchemaModel::Extremite &e) {
+	return(qHash(SchemaModel::key(e)));
+}
+
+/**
+	Vide le modele
+*/
+void SchemaModel::clear() {
+	proprietes.clear();
+	elements.clear();
+	conducteurs.clear();
+}
+
+/**
+	Lit un fichier *.qet
+	@param nom_fichier Chemin du schema
+	@param erreur Recoit la description de l'erreur eventuelle
+	@return true si la lecture a reussi, false sinon
+*/
+bool SchemaModel::load(const QString &nom_fichier, QString *erreur) {
+	QFile fichier(nom_fichier);
+	if (!fichier.open(QIODevice::ReadOnly)) {
+		if (erreur) *erreur = fichier.errorString();
+		return(false);
+	}
+	return(load(&fichier, erreur));
+}
+
+/**
+	Lit un schema en flux. Les conducteurs dont une borne est inconnue sont
+	ignores, comme au chargement d'un Schema.
+	@param entree Peripherique deja ouvert en lecture
+	@param erreur Recoit la description de l'erreur eventuelle
+	@return true si la lecture a reussi, false sinon
+*/
+bool SchemaModel::load(QIODevice *entree, QString *erreur) {
+	clear();
+	QXmlStreamReader lecteur(entree);
+	if (!lecteur.readNextStartElement() || lecteur.name() != "schema") {
+		if (erreur) *erreur = QString("la racine n'est pas un schema");
+		return(false);
+	}
+	foreach(const QXmlStreamAttribute &a, lecteur.attributes()) proprietes.insert(a.name().toString(), a.value().toString());
+	
+	// identifiant de borne du fichier -> extremite
+	QHash<int, Extremite> table_id;
+	while (lecteur.readNextStartElement()) {
+		if (lecteur.name() == "elements") {
+			while (lecteur.readNextStartElement()) {
+				if (lecteur.name() != "element") {
+					lecteur.skipCurrentElement();
+					continue;
+				}
+				QXmlStreamAttributes attributs = lecteur.attributes();
+				Elmt e;
+				e.type = attributs.value("type").toString();
+				e.pos = QPointF(attributs.value("x").toString().toDouble(), attributs.value("y").toString().toDouble());
+				e.sens = attributs.value("sens") != "false";
+				e.selectionne = attributs.value("selected") == "selected";
+				while (lecteur.readNextStartElement()) {
+					if (lecteur.name() != "bornes") {
+						lecteur.skipCurrentElement();
+						continue;
+					}
+					while (lecteur.readNextStartElement()) {
+						if (lecteur.name() == "borne") {
+							QXmlStreamAttributes ab = lecteur.attributes();
+							Borne b = {
+								ab.value("x").toString().toDouble(),
+								ab.value("y").toString().toDouble(),
+								ab.value("orientation").toString().toInt()
+							};
+							Extremite ex = { elements.size(), e.bornes.size() };
+							table_id.insert(ab.value("id").toString().toInt(), ex);
+							e.bornes << b;
+						}
+						lecteur.skipCurrentElement();
+					}
+				}
+				elements << e;
+			}
+		} else if (lecteur.name() == "conducteurs") {
+			while (lecteur.readNextStartElement()) {
+				if (lecteur.name() == "conductor") {
+					QXmlStreamAttributes attributs = lecteur.attributes();
+					int id1 = attributs.value("terminal1").toString().toInt();
+					int id2 = attributs.value("terminal2").toString().toInt();
+					if (table_id.contains(id1) && table_id.contains(id2) && id1 != id2) {
+						Conducteur c = { table_id.value(id1), table_id.value(id2), attributs.value("bundle").toString() };
+						conducteurs << c;
+					}
+				}
+				lecteur.skipCurrentElement();
+			}
+		} else lecteur.skipCurrentElement();
+	}
+	if (lecteur.hasError()) {
+		if (erreur) *erreur = lecteur.errorString();
+		return(false);
+	}
+	return(true);
+}
+
+/**
+	Ecrit le modele dans un fichier *.qet
+	@param nom_fichier Chemin du fichier a ecrire
+	@return true si l'ecriture a reussi, false sinon
+*/
+bool SchemaModel::save(const QString &nom_fichier) const {
+	QFile fichier(nom_fichier);
+	if (!fichier.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) return(false);
+	return(save(&fichier));
+}
+
+/**
+	Ecrit le modele en flux, dans le format de Schema::toXml(). Les bornes sont
+	numerotees dans l'ordre des elements.
+	@param sortie Peripherique deja ouvert en ecriture
+	@return true si l'ecriture a reussi, false sinon
+*/
+bool SchemaModel::save(QIODevice *sortie) const {
+	QXmlStreamWriter redacteur(sortie);
+	redacteur.setAutoFormatting(true);
+	redacteur.setAutoFormattingIndent(4);
+	redacteur.writeStartElement("schema");
+	for (QMap<QString, QString>::const_iterator it = proprietes.constBegin() ; it != proprietes.constEnd() ; ++ it) {
+		redacteur.writeAttribute(it.key(), it.value());
+	}
+	
+	// premier identifiant de borne de chaque element
+	QVector<int> premier_id(elements.size());
+	int id_borne = 0;
+	if (!elements.isEmpty()) {
+		redacteur.writeStartElement("elements");
+		for (int i = 0 ; i < elements.size() ; ++ i) {
+			const Elmt &e = elements.at(i);
+			premier_id[i] = id_borne;
+			redacteur.writeStartElement("element");
+			redacteur.writeAttribute("type", e.type);
+			redacteur.writeAttribute("x", QString::number(e.pos.x()));
+			redacteur.writeAttribute("y", QString::number(e.pos.y()));
+			if (e.selectionne) redacteur.writeAttribute("selected", "selected");
+			redacteur.writeAttribute("sens", e.sens ? "true" : "false");
+			redacteur.writeStartElement("bornes");
+			foreach(const Borne &b, e.bornes) {
+				redacteur.writeEmptyElement("borne");
+				redacteur.writeAttribute("x", QString::number(b.x));
+				redacteur.writeAttribute("y", QString::number(b.y));
+				redacteur.writeAttribute("orientation", QString::number(b.orientation));
+				redacteur.writeAttribute("id", QString::number(id_borne ++));
+			}
+			redacteur.writeEndElement();
+			redacteur.writeEndElement();
+		}
+		redacteur.writeEndElement();
+	}
+	
+	if (!conducteurs.isEmpty()) {
+		redacteur.writeStartElement("conducteurs");
+		foreach(const Conducteur &c, conducteurs) {
+			redacteur.writeEmptyElement("conductor");
+			redacteur.writeAttribute("terminal1", QString::number(premier_id.at(c.e1.element) + c.e1.borne));
+			redacteur.writeAttribute("terminal2", QString::number(premier_id.at(c.e2.element) + c.e2.borne));
+			if (!c.faisceau.isEmpty()) redacteur.writeAttribute("bundle", c.faisceau);
+		}
+		redacteur.writeEndElement();
+	}
+	redacteur.writeEndElement();
+	redacteur.writeEndDocument();
+	return(!redacteur.hasError());
+}
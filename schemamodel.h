@@ -0,0 +1,54 @@
+#ifndef SCHEMAMODEL_H
+	#define SCHEMAMODEL_H
+	#include <QtCore>
+	/**
+		Modele d'un schema *.qet reduit a des valeurs : elements, bornes et
+		conducteurs, sans scene ni items. Il est lu et ecrit en flux, ce qui
+		permet de comparer ou de fusionner de gros schemas rapidement et hors de
+		l'interface graphique.
+		Les conducteurs designent leurs bornes par l'element et le rang de la
+		borne dans l'element, et non par les identifiants du fichier : ceux-ci
+		sont renumerotes a l'ecriture.
+	*/
+	class SchemaModel {
+		public:
+		/// borne d'un element, telle qu'enregistree dans le fichier
+		struct Borne {
+			qreal x;
+			qreal y;
+			int orientation;
+		};
+		struct Elmt {
+			QString type;
+			QPointF pos;
+			bool sens;
+			bool selectionne;
+			QVector<Borne> bornes;
+		};
+		/// borne designee par son element et son rang dans l'element
+		struct Extremite {
+			int element;
+			int borne;
+			bool operator==(const Extremite &e) const { return(element == e.element && borne == e.borne); }
+		};
+		struct Conducteur {
+			Extremite e1;
+			Extremite e2;
+			/// numero du faisceau, vide pour un conducteur isole
+			QString faisceau;
+		};
+		
+		/// attributs du schema : auteur, date, titre
+		QMap<QString, QString> proprietes;
+		QVector<Elmt> elements;
+		QVector<Conducteur> conducteurs;
+		
+		bool load(const QString &, QString * = 0);
+		bool load(QIODevice *, QString * = 0);
+		bool save(const QString &) const;
+		bool save(QIODevice *) const;
+		void clear();
+		static quint64 key(const Extremite &);
+	};
+	uint qHash(const SchemaModel::Extremite &);
+#endif
@@ -4,6 +4,7 @@
 #include "contactor.h"
 #include "del.h"
 #include "entree.h"
+#include "paintstats.h"
 
 /**
 	Initialise le SchemaView
@@ -16,6 +17,7 @@ void SchemaView::initialise() {
 	setDragMode(RubberBandDrag);
 	setAcceptDrops(true);
 	setWindowTitle(tr("New schema") + "[*]");
+	stats_overlay = 0;
 	connect(scene, SIGNAL(selectionChanged()), this, SLOT(slot_selectionChanged()));
 }
 
@@ -34,6 +36,13 @@ SchemaView::SchemaView(QWidget *parent) : QGraphicsView(parent) {
 	initialise();
 }
 
+/**
+	Destructeur
+*/
+SchemaView::~SchemaView() {
+	setStatisticsShown(false);
+}
+
 /**
 	Permet de savoir si le rendu graphique du SchemaView est antialiase ou non.
 	@return Un booleen indiquant si le SchemaView est antialiase
@@ -59,8 +68,7 @@ void SchemaView::setAntialiasing(bool aa) {
 	@todo modifier selectAll pour l'integration des conducteurs
 */
 void SchemaView::selectAll() {
-	if (scene -> items().isEmpty()) return;
-	foreach (QGraphicsItem *item, scene -> items()) item -> setSelected(true);
+	scene -> selectAllElements();
 }
 
 /**
@@ -68,8 +76,7 @@ void SchemaView::selectAll() {
 	@todo modifier selectNothing pour l'integration des conducteurs
 */
 void SchemaView::selectNothing() {
-	if (scene -> items().isEmpty()) return;
-	foreach (QGraphicsItem *item, scene -> items()) item -> setSelected(false);
+	scene -> clearElementSelection();
 }
 
 /**
@@ -77,87 +84,29 @@ void SchemaView::selectNothing() {
 	@todo modifier selectInvert pour l'integration des conducteurs
  */
 void SchemaView::selectInvert() {
-	if (scene -> items().isEmpty()) return;
-	foreach (QGraphicsItem *item, scene -> items()) item -> setSelected(!item -> isSelected());
+	scene -> invertSelection();
 }
 
 /**
 	Supprime les composants selectionnes
 */
 void SchemaView::supprimer() {
-	QList<QGraphicsItem *> garbage_elmt;
-	QList<QGraphicsItem *>   garbage_conducteurs;
-	
-	// useless but careful : creating two lists : one for wires, one for elements
-	foreach (QGraphicsItem *qgi, scene -> selectedItems()) {
-		if (!garbage_elmt.contains(qgi)) garbage_elmt.append(qgi);
-		// pour chaque enfant de l'element
-		foreach (QGraphicsItem *child, qgi -> childItems()) {
-			// si cet enfant est une borne
-			if (Terminal *p = qgraphicsitem_cast<Terminal *>(child)) {
-				// alors chaque conducteur de la borne est recense
-				foreach (Conductor *f, p -> conducteurs()) {
-					if (!garbage_conducteurs.contains(f)) garbage_conducteurs.append(f);
-				}
-			}
-		}
-	}
-	scene -> clearSelection();
-	
-	// "destroying" the wires, removing them from the scene and stocking them into the  garbage 
-	foreach (QGraphicsItem *qgi, garbage_conducteurs) {
-		if (Conductor *f = qgraphicsitem_cast<Conductor *>(qgi)) {
-			f -> destroy();
-			scene -> removeItem(f);
-			throwToGarbage(f);
-		}
-	}
-	
-	// removing the elements from the scene and stocking them into the  garbage 
-	foreach (QGraphicsItem *qgi, garbage_elmt) {
-		scene -> removeItem(qgi);
-		throwToGarbage(qgi);
-	}
+	if (!scene -> selectedCount()) return;
+	QList<Element *> elements = scene -> selectedElements();
+	scene -> clearElementSelection();
+	// les items retires de la scene sont detruits par tranches, plus tard
+	corbeille.add(scene -> detachElements(elements));
 	resetCachedContent();
-	QTimer::singleShot(5000, this, SLOT(flushGarbage()));
-}
-
-/**
-	Envoie un item vers le "garbage" pour qu'il soit supprime plus tard
-	@param qgi L'item a supprimer
-*/
-void SchemaView::throwToGarbage(QGraphicsItem *qgi) {
-	// pas de doublon dans le garbage (sinon ca va sentir la segfault)
-	bool qgi_deja_dans_le_garbage = false;
-	foreach(QGraphicsItem *gbg_qgi, garbage) {
-		if ((void *)gbg_qgi == (void *)qgi) {
-			qgi_deja_dans_le_garbage = true;
-			break;
-		}
-	}
-	if (!qgi_deja_dans_le_garbage) garbage.append(qgi);
-}
-
-/**
-	Supprime tous les elements du "garbage"
-*/
-void SchemaView::flushGarbage() {
-	foreach(QGraphicsItem *qgi, garbage) {
-		delete(qgi);
-		garbage.removeAll(qgi);
-	}
 }
 
 /**
 	Pivote les composants selectionnes
 */
 void SchemaView::pivoter() {
-	if (scene -> selectedItems().isEmpty()) return;
-	foreach (QGraphicsItem *item, scene -> selectedItems()) {
-		if (Element *elt = qgraphicsitem_cast<Element *>(item)) {
-			elt -> invertOrientation();
-			elt -> update();
-		}
+	if (!scene -> selectedCount()) return;
+	foreach (Element *elt, scene -> selectedElements()) {
+		elt -> invertOrientation();
+		elt -> update();
 	}
 }
 
@@ -197,9 +146,9 @@ void SchemaView::dropEvent(QDropEvent *e) {
 	Element *el = new ElementPerso(file, 0, 0, &etat);
 	if (etat != 0) delete el;
 	else {
+		el -> setFlags(QGraphicsItem::ItemIsMovable | QGraphicsItem::ItemIsSelectable | QGraphicsItem::ItemSendsGeometryChanges);
 		scene -> addItem(el);
 		el -> setPos(mapToScene(e -> pos().x(), e -> pos().y()));
-		el -> setFlags(QGraphicsItem::ItemIsMovable | QGraphicsItem::ItemIsSelectable);
 	}
 }
 
@@ -314,39 +263,67 @@ Open a * .qet file in this SchemaView
 @return true if the opening was successful, false otherwise
 */
 bool SchemaView::open(QString n_fichier, int *erreur) {
-	// verifie l'existence du file
-	if (!QFileInfo(n_fichier).exists()) {
-		if (erreur != NULL) *erreur = 1;
-		return(false);
-	}
-	
-	// ouvre le file
-	QFile file(n_fichier);
-	if (!file.open(QIODevice::ReadOnly)) {
-		if (erreur != NULL) *erreur = 2;
-		return(false);
+	// le chargement est le meme que celui de l'outil en ligne de commande
+	if (!scene -> fromFile(n_fichier, erreur)) return(false);
+	nom_fichier = n_fichier;
+	setWindowTitle(nom_fichier + "[*]");
+	return(true);
+}
+
+/**
+	@return true si la surcouche de statistiques de rendu est affichee
+*/
+bool SchemaView::statisticsShown() const {
+	return(stats_overlay != 0);
+}
+
+/**
+	Affiche ou masque la surcouche de statistiques de rendu. Tant qu'aucune
+	vue ne l'affiche, les compteurs de rendu ne sont pas incrementes.
+	@param afficher true pour afficher la surcouche, false pour la masquer
+*/
+void SchemaView::setStatisticsShown(bool afficher) {
+	if (afficher == statisticsShown()) return;
+	if (afficher) {
+		stats_overlay = new PaintStatsOverlay(viewport());
+		stats_overlay -> show();
+		++ PaintStats::active;
+	} else {
+		delete stats_overlay;
+		stats_overlay = 0;
+		-- PaintStats::active;
 	}
-	
-	// lit son contenu dans un QDomDocument
-	QDomDocument document;
-	if (!document.setContent(&file)) {
-		if (erreur != NULL) *erreur = 3;
-		file.close();
-		return(false);
+	viewport() -> update();
+}
+
+/**
+	Exporte au format CSV les frames capturees depuis l'affichage de la surcouche
+	@param nom_fichier Chemin du fichier CSV a ecrire
+	@return true si l'export a reussi, false sinon
+*/
+bool SchemaView::exportStatistics(const QString &nom_fichier) const {
+	if (!stats_overlay) return(false);
+	return(stats_overlay -> exportCsv(nom_fichier));
+}
+
+/**
+	Dessine le schema ; si la surcouche de statistiques est affichee, le temps
+	de rendu et la zone exposee sont mesures.
+	@param e Le QPaintEvent decrivant la zone a redessiner
+*/
+void SchemaView::paintEvent(QPaintEvent *e) {
+	if (!stats_overlay) {
+		QGraphicsView::paintEvent(e);
+		return;
 	}
-	file.close();
+	QElapsedTimer chrono;
+	chrono.start();
+	QGraphicsView::paintEvent(e);
+	qint64 duree_us = chrono.nsecsElapsed() / 1000;
 	
-	// construit le schema a partir du QDomDocument
-	QDomDocument &doc = document;
-	if (scene -> fromXml(doc)) {
-		if (erreur != NULL) *erreur = 0;
-		nom_fichier = n_fichier;
-		setWindowTitle(nom_fichier + "[*]");
-		return(true);
-	} else {
-		if (erreur != NULL) *erreur = 4;
-		return(false);
-	}
+	qreal aire = 0.0;
+	for (const QRect &r : e -> region()) aire += (qreal)r.width() * r.height();
+	stats_overlay -> addFrame(PaintStats::endFrame(duree_us, aire));
 }
 
 void SchemaView::slot_selectionChanged() {
@@ -423,15 +400,10 @@ Otherwise, it returns true.
 @return true if the registration was successful, false otherwise
 */
 bool SchemaView::private_enregistrer(QString &n_fichier) {
-	QFile file(n_fichier);
-	if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+	if (!scene -> toFile(n_fichier)) {
 		QMessageBox::warning(this, tr("Erreur"), tr("Impossible d'ecrire dans ce file"));
 		return(false);
 	}
-	QTextStream out(&file);
-	out.setCodec("UTF-8");
-	out << scene -> toXml().toString(4);
-	file.close();
 	return(true);
 }
 
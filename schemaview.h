@@ -4,8 +4,10 @@
     #include <QDebug>
     #include <QUuid>
 	class Schema;
+	class PaintStatsOverlay;
 	#include "element.h"
 	#include "conductor.h"
+	#include "destructionqueue.h"
 	#define TAILLE_GRILLE 10
 	/**
 		Classe representant un SchemaView electrique
@@ -17,6 +19,7 @@
 		// constructeurs
 		SchemaView();
 		SchemaView(QWidget * = 0);
+		~SchemaView();
 		
 		// nouveaux attributs
 		Schema *scene;
@@ -29,14 +32,19 @@
 		QString nom_fichier;
 		bool enregistrer();
 		bool enregistrer_sous();
+		bool statisticsShown() const;
+		bool exportStatistics(const QString &) const;
 		QUuid   m_uuid;
+		protected:
+		void paintEvent(QPaintEvent *);
 		private:
 		bool private_enregistrer(QString &);
 		void initialise();
 		bool antialiasing; // booleen indiquant s'il faut effectuer un antialiasing sur le rendu graphique du SchemaView
-		QList<QGraphicsItem *> garbage;
+		/// items supprimes, en attente de destruction
+		DestructionQueue corbeille;
+		PaintStatsOverlay *stats_overlay; // surcouche de statistiques de rendu (0 si masquee)
 		
-		void throwToGarbage(QGraphicsItem *);
 		void mousePressEvent(QMouseEvent *);
 		void dragEnterEvent(QDragEnterEvent *);
 		void dragLeaveEvent(QDragLeaveEvent *);
@@ -56,6 +64,7 @@
 		void pivoter();
 		void setVisualisationMode();
 		void setSelectionMode();
+		void setStatisticsShown(bool);
 		void zoomPlus();
 		void zoomMoins();
 		void zoomFit();
@@ -65,7 +74,6 @@
 		void coller();
 		
 		private slots:
-		void flushGarbage();
 		void slot_selectionChanged();
 	};
 #endif
@@ -0,0 +1,162 @@
+#ifndef SPATIALINDEX_H
+	#define SPATIALINDEX_H
+	#include <QtCore>
+	/**
+		Index spatial a grille uniforme. Chaque objet est reference dans toutes
+		les cellules couvertes par son rectangle ; une requete ne parcourt donc
+		que les cellules de la zone demandee, quelle que soit la taille de la scene.
+		Les rectangles de largeur ou de hauteur nulle (segments horizontaux ou
+		verticaux, points) sont acceptes.
+		Un index qui n'est plus modifie peut etre interroge depuis plusieurs
+		threads a la fois.
+	*/
+	template <typename T> class SpatialIndex {
+		public:
+		SpatialIndex(qreal = 100.0);
+		void insert(const T &, const QRectF &);
+		void remove(const T &);
+		void update(const T &, const QRectF &);
+		void clear();
+		bool contains(const T &o) const { return(rects.contains(o)); }
+		QRectF rect(const T &o) const { return(rects.value(o)); }
+		int size() const { return(rects.size()); }
+		QList<T> items() const { return(rects.keys()); }
+		QList<T> query(const QRectF &) const;
+		static bool chevauche(const QRectF &, const QRectF &);
+
+		private:
+		qreal taille_cellule;
+		QHash<quint64, QVector<T> > cellules;
+		QHash<T, QRectF> rects;
+		int cellule(qreal c) const { return((int)qFloor(c / taille_cellule)); }
+		static quint64 cle(int x, int y) { return((quint64(quint32(x)) << 32) | quint32(y)); }
+		void collecte(const QVector<T> &, int, int, int, int, const QRectF &, QList<T> &) const;
+	};
+
+	/**
+		Constructeur
+		@param taille Cote d'une cellule de la grille, en unites de la scene
+	*/
+	template <typename T> SpatialIndex<T>::SpatialIndex(qreal taille) : taille_cellule(taille) {
+	}
+
+	/**
+		Reference un objet dans l'index. Si l'objet y est deja, il est deplace.
+		@param o L'objet a referencer
+		@param r Le rectangle (en coordonnees de la scene) occupe par l'objet
+	*/
+	template <typename T> void SpatialIndex<T>::insert(const T &o, const QRectF &r) {
+		if (rects.contains(o)) remove(o);
+		QRectF n = r.normalized();
+		rects.insert(o, n);
+		int x2 = cellule(n.right()), y2 = cellule(n.bottom());
+		for (int x = cellule(n.left()) ; x <= x2 ; ++ x) {
+			for (int y = cellule(n.top()) ; y <= y2 ; ++ y) cellules[cle(x, y)].append(o);
+		}
+	}
+
+	/**
+		Retire un objet de l'index
+		@param o L'objet a retirer
+	*/
+	template <typename T> void SpatialIndex<T>::remove(const T &o) {
+		typename QHash<T, QRectF>::iterator it = rects.find(o);
+		if (it == rects.end()) return;
+		QRectF n = it.value();
+		rects.erase(it);
+		int x2 = cellule(n.right()), y2 = cellule(n.bottom());
+		for (int x = cellule(n.left()) ; x <= x2 ; ++ x) {
+			for (int y = cellule(n.top()) ; y <= y2 ; ++ y) {
+				typename QHash<quint64, QVector<T> >::iterator c = cellules.find(cle(x, y));
+				if (c == cellules.end()) continue;
+				QVector<T> &liste = c.value();
+				int index = liste.indexOf(o);
+				if (index != -1) {
+					// l'ordre dans une cellule est sans importance
+					liste[index] = liste.last();
+					liste.removeLast();
+				}
+				if (liste.isEmpty()) cellules.erase(c);
+			}
+		}
+	}
+
+	/**
+		Deplace un objet dans l'index ; ne fait rien si son rectangle n'a pas change
+		@param o L'objet a deplacer
+		@param r Le nouveau rectangle de l'objet
+	*/
+	template <typename T> void SpatialIndex<T>::update(const T &o, const QRectF &r) {
+		if (rects.contains(o) && rects.value(o) == r.normalized()) return;
+		insert(o, r);
+	}
+
+	/**
+		Vide l'index
+	*/
+	template <typename T> void SpatialIndex<T>::clear() {
+		cellules.clear();
+		rects.clear();
+	}
+
+	/**
+		@param zone Rectangle de recherche, en coordonnees de la scene
+		@return Les objets dont le rectangle touche la zone, chacun une seule fois
+	*/
+	template <typename T> QList<T> SpatialIndex<T>::query(const QRectF &zone) const {
+		QList<T> resultat;
+		if (rects.isEmpty()) return(resultat);
+		QRectF n = zone.normalized();
+		int x1 = cellule(n.left()), y1 = cellule(n.top());
+		int x2 = cellule(n.right()), y2 = cellule(n.bottom());
+		
+		// pour une zone tres etendue, mieux vaut parcourir les seules cellules occupees
+		if (qint64(x2 - x1 + 1) * qint64(y2 - y1 + 1) > cellules.size()) {
+			for (typename QHash<quint64, QVector<T> >::const_iterator c = cellules.constBegin() ; c != cellules.constEnd() ; ++ c) {
+				int x = int(quint32(c.key() >> 32));
+				int y = int(quint32(c.key()));
+				if (x < x1 || x > x2 || y < y1 || y > y2) continue;
+				collecte(c.value(), x, y, x1, y1, n, resultat);
+			}
+			return(resultat);
+		}
+		
+		for (int x = x1 ; x <= x2 ; ++ x) {
+			for (int y = y1 ; y <= y2 ; ++ y) {
+				typename QHash<quint64, QVector<T> >::const_iterator c = cellules.constFind(cle(x, y));
+				if (c == cellules.constEnd()) continue;
+				collecte(c.value(), x, y, x1, y1, n, resultat);
+			}
+		}
+		return(resultat);
+	}
+
+	/**
+		Ajoute au resultat d'une requete les objets d'une cellule touchant la zone
+		@param liste Contenu de la cellule
+		@param x Abscisse de la cellule dans la grille
+		@param y Ordonnee de la cellule dans la grille
+		@param x1 Abscisse de la premiere cellule de la zone
+		@param y1 Ordonnee de la premiere cellule de la zone
+		@param zone Zone recherchee
+		@param resultat Liste a completer
+	*/
+	template <typename T> void SpatialIndex<T>::collecte(const QVector<T> &liste, int x, int y, int x1, int y1, const QRectF &zone, QList<T> &resultat) const {
+		foreach(const T &o, liste) {
+			QRectF r = rects.value(o);
+			if (!chevauche(r, zone)) continue;
+			// un objet couvrant plusieurs cellules n'est rapporte que dans la
+			// premiere cellule commune a la zone et a son rectangle
+			if (x != qMax(x1, cellule(r.left())) || y != qMax(y1, cellule(r.top()))) continue;
+			resultat << o;
+		}
+	}
+
+	/**
+		Variante de QRectF::intersects acceptant les rectangles vides
+		@return true si les deux rectangles (normalises) se touchent
+	*/
+	template <typename T> bool SpatialIndex<T>::chevauche(const QRectF &a, const QRectF &b) {
+		return(a.left() <= b.right() && b.left() <= a.right() && a.top() <= b.bottom() && b.top() <= a.bottom());
+	}
+#endif
@@ -2,6 +2,8 @@
 #include "schema.h"
 #include "element.h"
 #include "conductor.h"
+#include "conductorbundle.h"
+#include "paintstats.h"
 #include "debug.h"
 /**
 Private function to initialize the terminal.
@@ -27,13 +29,13 @@ void Terminal::initialise(QPointF pf, Terminal::Orientation o) {
 	}
 	
 	// par defaut : pas de conducteur
+	faisceau = NULL;
 	
 	// QRectF null
 	br = new QRectF();
 	terminal_precedente = NULL;
 	// divers
-	//setAcceptsHoverEvents(true);
-	setAcceptHoverEvents(true);
+	// le survol est suivi par le Schema, a l'aide de son index des bornes
 	setAcceptedMouseButtons(Qt::LeftButton);
 	hovered = false;
 	setToolTip("Terminal");
@@ -152,6 +154,7 @@ Terminal drawing function
 @param widget The widget we are drawing on
 */
 void Terminal::paint(QPainter *p, const QStyleOptionGraphicsItem *, QWidget *) {
+	PAINTSTATS_COUNT(terminals);
 	p -> save();
 	//annulation des renderhints
 	p -> setRenderHint(QPainter::Antialiasing,          false);
@@ -202,24 +205,13 @@ QRectF Terminal::boundingRect() const
 }
 
 /**
- Manages the entry of the mouse on the area of ??the Terminal.
+	Highlights the terminal, or removes the highlight ; called by the Schema,
+	which tracks the terminal under the pointer.
+	@param h true if the pointer is over the terminal
 */
-void Terminal::hoverEnterEvent(QGraphicsSceneHoverEvent *) {
-	hovered = true;
-	update();
-}
-
-/**
- Manages mouse movements on the Terminal area.
-*/
-void Terminal::hoverMoveEvent(QGraphicsSceneHoverEvent *) {
-}
-
-/**
- Handles the fact that the mouse goes out of the Kiosk area.
-*/
-void Terminal::hoverLeaveEvent(QGraphicsSceneHoverEvent *) {
-	hovered = false;
+void Terminal::setHovered(bool h) {
+	if (hovered == h) return;
+	hovered = h;
 	update();
 }
 
@@ -232,7 +224,7 @@ void Terminal::mousePressEvent(QGraphicsSceneMouseEvent *e) {
 		s -> setDepart(mapToScene(QPointF(amarrage_conducteur)));
 		s -> setArrivee(e -> scenePos());
 		s -> poseConducteur(true);
-		setCursor(Qt::CrossCursor);
+		s -> setWiringCursor(true);
 	}
 	//QGraphicsItem::mouseReleaseEvent(e);
 }
@@ -242,9 +234,6 @@ void Terminal::mousePressEvent(QGraphicsSceneMouseEvent *e) {
 	@param e The corresponding mouse event
 */
 void Terminal::mouseMoveEvent(QGraphicsSceneMouseEvent *e) {
-	// during the installation of a conductor, we adopt another cursor
-	setCursor(Qt::CrossCursor);
-	
 	// from one movement to another, we must remove the hover effect from the previous bound
 	if (terminal_precedente != NULL) {
 		if (terminal_precedente == this) hovered = true;
@@ -253,65 +242,65 @@ void Terminal::mouseMoveEvent(QGraphicsSceneMouseEvent *e) {
 		terminal_precedente -> update();
 	}
 	
-	// if the scene is a Schema, we update the driver installer
-	if (Schema *s = qobject_cast<Schema *>(scene())) s -> setArrivee(e -> scenePos());
-	
-	// we get the list of qgi under the pointer
-	QList<QGraphicsItem *> qgis = scene() -> items(e -> scenePos());
-	
-	/* the highest qgi
-		= the driver installer
-		= the first element of the list
-		= the list cannot be empty
-		= we take the second element of the list
-	*/
-	Q_ASSERT_X(!(qgis.isEmpty()), "Terminal::mouseMoveEvent", "The list of items should not be empty");
+	// the conductor being drawn snaps to the terminal it would be connected to
+	Terminal *p = cible(e -> scenePos());
+	if (Schema *s = qobject_cast<Schema *>(scene())) s -> setArrivee(p ? p -> amarrageConducteur() : e -> scenePos());
 	
-	// if there is something other than the driver setter in the list
-	if (qgis.size() > 1) {
-		// we take the second element of the list
-		QGraphicsItem *qgi = qgis.at(1);
-		// if the qgi is a bound ...
-		if (Terminal *p = qgraphicsitem_cast<Terminal *>(qgi)) {
+	if (p) {
 		// we apply the appropriate hover effect
-			if (p == this) {
-			// effect if we hover on the starting terminal
-				couleur_hovered = couleur_interdit;
-			} else if (p -> parentItem() == parentItem()) {
-			// effect if we hover on a terminal of the same device
-				if (((Element *)parentItem()) -> connexionsInternesAcceptees())
-					p -> couleur_hovered = p -> couleur_autorise;
-				else p -> couleur_hovered = p -> couleur_interdit;
-			} else if (p -> nbConducteurs()) {
-			// if the terminal already has a conductor
-			// check that this terminal is not already linked to the other terminal
-				bool deja_reliee = false;
-				foreach (Conductor *f, liste_conducteurs) {
-					if (f -> terminal1 == p || f -> terminal2 == p) {
-						deja_reliee = true;
-						break;
-					}
-				}
-				// forbidden if the terminals are already connected, caution otherwise
-				p -> couleur_hovered = deja_reliee ? p -> couleur_interdit : p -> couleur_prudence;
-			} else {
-			// effect if we can put the conductor
+		if (p == this) {
+		// effect if we hover on the starting terminal
+			couleur_hovered = couleur_interdit;
+		} else if (p -> parentItem() == parentItem()) {
+		// effect if we hover on a terminal of the same device
+			if (((Element *)parentItem()) -> connexionsInternesAcceptees())
 				p -> couleur_hovered = p -> couleur_autorise;
+			else p -> couleur_hovered = p -> couleur_interdit;
+		} else if (p -> nbConducteurs()) {
+		// if the terminal already has a conductor
+		// check that this terminal is not already linked to the other terminal
+			bool deja_reliee = false;
+			foreach (Conductor *f, liste_conducteurs) {
+				if (f -> terminal1 == p || f -> terminal2 == p) {
+					deja_reliee = true;
+					break;
+				}
 			}
-			terminal_precedente = p;
-			p -> hovered = true;
-			p -> update();
+			// forbidden if the terminals are already connected, caution otherwise
+			p -> couleur_hovered = deja_reliee ? p -> couleur_interdit : p -> couleur_prudence;
+		} else {
+		// effect if we can put the conductor
+			p -> couleur_hovered = p -> couleur_autorise;
 		}
+		terminal_precedente = p;
+		p -> hovered = true;
+		p -> update();
 	}
 }
 
+/**
+	Finds the terminal a conductor started from this terminal would be connected
+	to : the nearest free terminal within RAYON_AIMANTATION, or else the terminal
+	right under the point. Both lookups use the terminal index of the Schema, so
+	they do not depend on the number of items in the scene.
+	@param point Position of the pointer, in scene coordinates
+	@return The terminal, or 0 if there is none
+*/
+Terminal *Terminal::cible(const QPointF &point) {
+	Schema *s = qobject_cast<Schema *>(scene());
+	if (!s) return(0);
+	if (Terminal *t = s -> nearestFreeTerminal(point, RAYON_AIMANTATION, this)) return(t);
+	return(s -> terminalAt(point));
+}
+
 /**
 	Handles the fact that the mouse is released on the Terminal.
 	@param e The corresponding mouse event
 */
 void Terminal::mouseReleaseEvent(QGraphicsSceneMouseEvent *e) {
 	trace_msg("");
-	setCursor(Qt::ArrowCursor);
+	// the terminal hovered while wiring is no longer highlighted
+	if (terminal_precedente && terminal_precedente != this) terminal_precedente -> setHovered(false);
 	terminal_precedente = NULL;
 	couleur_hovered  = couleur_neutre;
  // check that the scene is indeed a Schema
@@ -319,12 +308,10 @@ void Terminal::mouseReleaseEvent(QGraphicsSceneMouseEvent *e) {
 
  // we stop drawing the driver preview
 		s -> poseConducteur(false);
- // we get the element under the pointer during the MouseReleaseEvent
-		QGraphicsItem *qgi = s -> itemAt(e -> scenePos(),QTransform() );
- // if there is nothing, we stop it
-		if (!qgi) return;
- // same if the obtained element is not a bound
-		Terminal *p = qgraphicsitem_cast<Terminal *>(qgi);
+		s -> setWiringCursor(false);
+ // we get the terminal the conductor snaps to
+		Terminal *p = cible(e -> scenePos());
+ // if there is none, we stop it
 		if (!p) return;
  // we reset the hover color to its default value
 		p -> couleur_hovered = p -> couleur_neutre;
@@ -336,7 +323,7 @@ void Terminal::mouseReleaseEvent(QGraphicsSceneMouseEvent *e) {
  // last check: check that this terminal is not already linked to the other terminal
 		foreach (Conductor *f, liste_conducteurs) if (f -> terminal1 == p || f -> terminal2 == p) return;
  // otherwise, we put a conductor
-		new Conductor(this, (Terminal *)qgi, 0, scene());
+		new Conductor(this, p, 0, scene());
 	}
 }
 
@@ -347,9 +334,10 @@ void Terminal::updateConducteur() {
 	if (scene()) {
 		foreach(Conductor * conductor, liste_conducteurs) { 
 			if (!conductor->isDestroyed()) {
-				conductor->update(QRectF()/*scene()->sceneRect()*/);
+				conductor -> markDirty();
 			}
 		}
+		if (faisceau && !faisceau -> isDestroyed()) faisceau -> markDirty();
 	}
 }
 
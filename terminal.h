@@ -4,6 +4,7 @@
 	#include <QtWidgets>
 	#include <QtXml/QtXml>
 	class Conductor;
+	class ConductorBundle;
 	class Element;
 	class Schema;
 	/**
@@ -35,12 +36,16 @@
 		bool addConducteur(Conductor *);
 		void removeConducteur(Conductor *);
 		inline int nbConducteurs() { return(liste_conducteurs.size()); }
+		// faisceau de conducteurs auquel appartient la borne
+		inline ConductorBundle *bundle() const { return(faisceau); }
+		inline void setBundle(ConductorBundle *f) { faisceau = f; }
 		
 		// methodes de lecture
 		QList<Conductor *> conducteurs() const; 
 		Terminal::Orientation orientation() const;
 		inline QPointF amarrageConducteur() const { return(mapToScene(amarrage_conducteur)); }
 		void updateConducteur();
+		void setHovered(bool);
 		
 		// methods relating to import / export in XML format
 		static bool valideXml(QDomElement  &);
@@ -48,9 +53,6 @@
 		QDomElement toXml    (QDomDocument &);
 		
 		// event management methods
-		void hoverEnterEvent  (QGraphicsSceneHoverEvent *);
-		void hoverMoveEvent   (QGraphicsSceneHoverEvent *);
-		void hoverLeaveEvent  (QGraphicsSceneHoverEvent *);
 		void mousePressEvent  (QGraphicsSceneMouseEvent *);
 		void mouseMoveEvent   (QGraphicsSceneMouseEvent *);
 		void mouseReleaseEvent(QGraphicsSceneMouseEvent *);
@@ -65,12 +67,16 @@
 		Terminal::Orientation sens;
 		// liste des conducteurs lies a cette borne
 		QList<Conductor *> liste_conducteurs;
+		// faisceau auquel la borne est reliee, le cas echeant
+		ConductorBundle *faisceau;
 		// pointeur vers un rectangle correspondant au bounding rect ; permet de ne calculer le bounding rect qu'une seule fois ; le pointeur c'est parce que le compilo exige une methode const
 		QRectF *br;
 		Terminal *terminal_precedente;
 		bool hovered;
 		// methode initialisant les differents membres de la borne
 		void initialise(QPointF, Terminal::Orientation);
+		// terminal to which a conductor started from this terminal would be connected
+		Terminal *cible(const QPointF &);
 		// differentes couleurs utilisables pour l'effet "hover"
 		QColor couleur_hovered;
 		QColor couleur_neutre;